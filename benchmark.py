@@ -0,0 +1,250 @@
+import argparse
+import csv
+import json
+import os
+import shlex
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+# expected answer of every instance of a suite. the LRAN instances are the
+# large random ones from SATLIB, all satisfiable
+SUITES = {"UF": "SAT", "UUF": "UNSAT", "LRAN": "SAT"}
+
+# statuses that mean a solver is broken, as opposed to too slow
+FAILURES = ("wrong", "bad model", "error")
+
+# runs that once went wrong, checked along with the suites unless
+# --no-regressions is given: the solver command, the instance under the
+# testcases folder and the expected answer
+REGRESSIONS = [
+    ("./cdcl --no-preprocess --local-search 1000", "UUF/empty-clause.cnf", "UNSAT"),
+]
+
+FIELDS = [
+    "solver",
+    "suite",
+    "instance",
+    "expected",
+    "result",
+    "status",
+    "time",
+    "decisions",
+    "propagations",
+    "conflicts",
+    "restarts",
+    "max_rss_kb",
+]
+
+
+# Parse a formula the way cnf.h does: DIMACS after a "p cnf" header, or one
+# clause per line with "~" for a negation. Returns the clauses as lists of
+# (name, negated) pairs
+def read_cnf(path):
+    clauses, current, dimacs, started = [], [], False, False
+    with open(path) as file:
+        for line in file:
+            tokens = line.split()
+            header = tokens[:2] == ["p", "cnf"]
+            if header or (tokens[:1] == ["c"] and (dimacs or not started)):
+                dimacs = dimacs or header
+                continue
+            started = started or bool(tokens)
+            end = "%" in tokens
+            if end:
+                tokens = tokens[: tokens.index("%")]
+            for token in tokens:
+                if dimacs and token == "0":
+                    clauses.append(current)
+                    current = []
+                else:
+                    current.append((token.lstrip("-~"), token[0] in "-~"))
+            if not dimacs and current:
+                clauses.append(current)
+                current = []
+            if end:
+                break
+    if current:
+        clauses.append(current)
+    return clauses
+
+
+# Check the assignment written by a solver against the formula
+def check_model(cnf_path, model_path):
+    if not os.path.exists(model_path):
+        return False
+    value = {}
+    with open(model_path) as file:
+        for line in file:
+            name = line.strip()
+            if name:
+                value[name.lstrip("~")] = not name.startswith("~")
+    return all(
+        any(value.get(name, False) != negated for name, negated in clause)
+        for clause in read_cnf(cnf_path)
+    )
+
+
+# Run one solver on one instance in a scratch directory, so that the
+# solution files of parallel or successive runs do not mix
+def run(command, instance, timeout):
+    with tempfile.TemporaryDirectory() as workdir:
+        stdout_path = os.path.join(workdir, "stdout.txt")
+        with open(stdout_path, "w") as stdout:
+            start = time.monotonic()
+            process = subprocess.Popen(
+                command + [instance],
+                cwd=workdir,
+                stdout=stdout,
+                stderr=subprocess.DEVNULL,
+            )
+            killed = threading.Event()
+
+            def kill():
+                killed.set()
+                process.kill()
+
+            timer = threading.Timer(timeout, kill)
+            timer.start()
+            _, _, usage = os.wait4(process.pid, 0)
+            timer.cancel()
+            elapsed = time.monotonic() - start
+
+        record = {"time": round(elapsed, 3), "max_rss_kb": usage.ru_maxrss}
+        with open(stdout_path) as stdout:
+            for line in stdout:
+                key, _, number = line.partition(":")
+                key = key.strip()
+                if key in ("Decisions", "Propagations", "Conflicts", "Restarts"):
+                    record[key.lower()] = int(number)
+                if "UNSATISFIABLE" in line:
+                    record["result"] = "UNSAT"
+                elif "SATISFIABLE" in line:
+                    record["result"] = "SAT"
+                elif line.startswith("s UNKNOWN"):
+                    record["result"] = "UNKNOWN"
+
+        if killed.is_set():
+            record["result"] = "TIMEOUT"
+        elif "result" not in record:
+            record["result"] = "ERROR"
+        elif record["result"] == "SAT":
+            model = os.path.join(workdir, "output_dpll.txt")
+            record["model_ok"] = check_model(instance, model)
+        return record
+
+
+# the status of a run given the expected answer
+def judge(record, expected):
+    model_ok = record.pop("model_ok", True)
+    if record["result"] in ("TIMEOUT", "ERROR", "UNKNOWN"):
+        return record["result"].lower()
+    if record["result"] != expected:
+        return "wrong"
+    if not model_ok:
+        return "bad model"
+    return "ok"
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(
+        description="Run the solvers over the test suites and record the results."
+    )
+    parser.add_argument(
+        "--solver",
+        action="append",
+        help="solver command, may include options (default: ./dpll and ./cdcl)",
+    )
+    parser.add_argument(
+        "--suite",
+        action="append",
+        choices=sorted(SUITES),
+        help="suite of TESTCASES to run (default: all)",
+    )
+    parser.add_argument("--testcases", default=os.path.join(here, "TESTCASES"))
+    parser.add_argument(
+        "--timeout", type=float, default=60, help="seconds per instance"
+    )
+    parser.add_argument("--limit", type=int, help="instances per suite")
+    parser.add_argument("--csv", help="write the results as CSV to this file")
+    parser.add_argument("--json", help="write the results as JSON to this file")
+    parser.add_argument(
+        "--no-regressions", action="store_true", help="skip the REGRESSIONS runs"
+    )
+    args = parser.parse_args()
+
+    solvers = args.solver or ["./dpll", "./cdcl"]
+    suites = args.suite or ["UF", "UUF", "LRAN"]
+
+    width = max(len(solver) for solver in solvers)
+    rows = []
+    for solver in solvers:
+        command = shlex.split(solver)
+        command[0] = os.path.abspath(command[0])
+        for suite in suites:
+            folder = os.path.join(args.testcases, suite)
+            instances = sorted(
+                f for f in os.listdir(folder) if f.endswith(".cnf")
+            )
+            for name in instances[: args.limit]:
+                record = run(command, os.path.join(folder, name), args.timeout)
+                expected = SUITES[suite]
+                status = judge(record, expected)
+                row = {"solver": solver, "suite": suite, "instance": name}
+                row.update(expected=expected, status=status, **record)
+                rows.append(row)
+                print(
+                    f"{solver:{width}} {suite:5} {name:20} {row['result']:8} "
+                    f"{status:10} {row['time']:8.3f}s",
+                    flush=True,
+                )
+
+    regressions = [] if args.no_regressions else REGRESSIONS
+    for solver, instance, expected in regressions:
+        command = shlex.split(solver)
+        command[0] = os.path.abspath(command[0])
+        record = run(command, os.path.join(args.testcases, instance), args.timeout)
+        status = judge(record, expected)
+        row = {"solver": solver, "suite": "regression", "instance": instance}
+        row.update(expected=expected, status=status, **record)
+        rows.append(row)
+        print(
+            f"{solver} {instance} {row['result']} {status} {row['time']:.3f}s",
+            flush=True,
+        )
+
+    # one line per solver and suite: solved instances, failures and the
+    # total time, counting a timeout as the full timeout
+    print()
+    for solver in solvers:
+        for suite in suites:
+            group = [
+                r for r in rows if r["solver"] == solver and r["suite"] == suite
+            ]
+            solved = sum(r["status"] == "ok" for r in group)
+            failed = sum(r["status"] in FAILURES for r in group)
+            total = sum(r["time"] for r in group)
+            print(
+                f"{solver:{width}} {suite:5} solved {solved}/{len(group)}, "
+                f"{failed} failed, {total:.2f}s"
+            )
+
+    if args.csv:
+        with open(args.csv, "w", newline="") as file:
+            writer = csv.DictWriter(file, fieldnames=FIELDS)
+            writer.writeheader()
+            writer.writerows(rows)
+    if args.json:
+        with open(args.json, "w") as file:
+            json.dump(rows, file, indent=2)
+
+    # a wrong answer is a failure of the run, a timeout or an unknown answer
+    # from an incomplete solver is not
+    return 1 if any(r["status"] in FAILURES for r in rows) else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
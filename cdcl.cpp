@@ -1,321 +1,356 @@
-#include <bits/stdc++.h>
+#include "cdcl.h"
+#include "local.h"
+#include "output.h"
+#include "preprocess.h"
 
 class DPLL {
 private:
-  std::set<std::string> assign_t, assign_f;
-  int n_prop = 0, n_decs = 0;
-
-  std::unordered_map<std::string, double> score_map;
-  std::vector<std::string> variable_order;
-
-  int conflicts = 0;
-  const double bonus = 1.0;
-  const double level_factor = 2.0;
-  const int level_interval = 1000;
-
-  // initialize the scores to the frequency of the variables in the clauses
-  void initialize_scores(const std::vector<std::string> &cnf) {
-    for (const auto &clause : cnf) {
-      std::istringstream iss(clause);
-      std::string literal;
-      while (iss >> literal) {
-        std::string var = (literal[0] == '~') ? literal.substr(1) : literal;
-        if (score_map.find(var) == score_map.end()) {
-          score_map[var] = 0.0;
-        }
-        score_map[var] += 1.0;
-      }
-    }
-    update_variable_order();
+  CNF cnf;
+  Config config;
+  ProofWriter proof;
+  bool logging = false; // whether the engines write to the proof
+  std::vector<signed char> phases; // from local search, empty without it
+
+  // worker 0 runs the base configuration, the others vary the seed, the
+  // VSIDS decay, the share of random decisions, the restart policy and the
+  // phase
+  Config diversify(const Config &base, int id) {
+    static const double decays[] = {0.95, 0.90, 0.99, 0.85};
+    static const double random_freqs[] = {0.0, 0.01, 0.02, 0.05};
+    static const Restarts restarts[] = {GLUCOSE_RESTARTS, LUBY_RESTARTS};
+    static const int luby_units[] = {100, 512, 32};
+    Config config = base;
+    if (id == 0)
+      return config;
+    config.seed = id;
+    config.var_decay = decays[id % 4];
+    config.random_freq = random_freqs[(id / 4) % 4];
+    config.negative_phase = id % 2;
+    config.restarts = restarts[(id / 2) % 2];
+    config.luby_unit = luby_units[id % 3];
+    return config;
   }
 
-  // arrange the variables in descending order
-  void update_variable_order() {
-    variable_order.clear();
-    for (const auto &entry : score_map) {
-      variable_order.push_back(entry.first);
-    }
-    std::sort(variable_order.begin(), variable_order.end(),
-              [this](const std::string &a, const std::string &b) {
-                return score_map[a] > score_map[b];
-              });
+  // adds what an engine stopped by the budget leaves to partial: the
+  // literals it fixed at the root, and its best assignment if it has more
+  // variables set than the one kept so far
+  void keep(const CDCL &engine, Partial &partial) {
+    partial.units.insert(partial.units.end(), engine.solver.trail.begin(),
+                         engine.solver.trail.end());
+    std::sort(partial.units.begin(), partial.units.end());
+    partial.units.erase(
+        std::unique(partial.units.begin(), partial.units.end()),
+        partial.units.end());
+    auto n_set = [](const std::vector<signed char> &assign) {
+      return assign.size() - std::count(assign.begin(), assign.end(), 0);
+    };
+    if (n_set(engine.best) > n_set(partial.assign))
+      partial.assign = engine.best;
   }
 
-  // choose the variable with maxmium score
-  std::string decision(std::set<std::string> &literals) {
-    for (const auto &var : variable_order) {
-      if (literals.find(var) != literals.end()) {
-        return var;
-      }
+  // races diversified engines, the first to finish stops the others. when
+  // the budget stops them all, the stats are those of all of them and
+  // partial gets what they leave
+  Result portfolio(int n_workers, std::vector<signed char> &model,
+                   Stats &stats, Progress &progress, Partial &partial) {
+    ClauseExchange exchange;
+    std::atomic<bool> stop{false};
+    std::deque<CDCL> engines;
+    std::vector<std::thread> workers;
+    std::mutex mtx;
+    Result result = UNKNOWN;
+
+    for (int id = 0; id < n_workers; id++) {
+      engines.emplace_back();
+      engines.back().config = diversify(config, id);
     }
-    return *literals.begin();
-  }
-
-  // give bonus to the variables in the learned clause, and level the scores
-  void update_scores(const std::vector<std::string> &learned_clause) {
-    for (const auto &literal : learned_clause) {
-      std::string var = (literal[0] == '~') ? literal.substr(1) : literal;
-      score_map[var] += bonus;
+    for (int id = 0; id < n_workers; id++) {
+      workers.emplace_back([&, id]() {
+        CDCL &engine = engines[id];
+        engine.join(id, &exchange, &stop);
+        engine.report(&progress);
+        if (budget.limited())
+          engine.limit(&budget);
+        if (logging)
+          engine.solver.proof = &proof;
+        bool loaded = engine.load(cnf);
+        engine.set_phases(phases);
+        Result r = loaded ? engine.solve() : UNSATISFIABLE;
+        if (r != UNKNOWN && !stop.exchange(true)) {
+          std::lock_guard<std::mutex> lock(mtx);
+          result = r;
+          model = engine.model;
+          stats = engine.stats();
+        }
+      });
     }
-
-    conflicts++;
-
-    if (conflicts % level_interval == 0) {
-      for (auto &entry : score_map) {
-        entry.second /= level_factor;
+    for (auto &w : workers)
+      w.join();
+    if (result == UNKNOWN) {
+      for (CDCL &engine : engines) {
+        stats += engine.stats();
+        keep(engine, partial);
       }
     }
-
-    update_variable_order();
+    return result;
   }
 
-  void print_cnf(const std::vector<std::string> &cnf) {
-    std::string CNF;
-    // parse through the cnf
-    for (const auto &clause : cnf) {
-      // if the clause is not empty, add it to the string
-      if (!clause.empty())
-        CNF += "(" + clause + ")";
+public:
+  // limits on the search, none by default. a search stopped by them
+  // answers "s UNKNOWN"
+  Budget budget;
+
+  // solves with a single engine, or with a portfolio of n_workers. a
+  // progress line is printed every second, and with print_stats the time of
+  // every phase at the end. with a proof file, a DRAT proof of the learned
+  // clauses is written along the way; the preprocessor does not log its
+  // steps, so it is skipped then. with a flip budget, local search runs
+  // first: its model is the answer if it finds one, otherwise its best
+  // assignment becomes the initial phases of the engines. once the budget
+  // is spent, the answer is "s UNKNOWN" and, given a dump file, what the
+  // search leaves is written to it for a later run to resume from: the
+  // units it fixed are added to the formula of that run and the fullest
+  // assignment it reached gives the initial phases. returns the exit status
+  int dpll(const std::string &filename, int n_workers = 1,
+           Restarts restarts = GLUCOSE_RESTARTS, bool preprocess = true,
+           bool print_stats = false, const std::string &proof_file = "",
+           long long local_flips = 0, const std::string &dump_file = "",
+           const std::string &resume_file = "") {
+    Stats stats;
+    {
+      PhaseTimer timer(stats.parse);
+      if (!cnf.load(filename))
+        return 1;
     }
-    // if the string is empty, add an empty clause
-    if (CNF.empty())
-      CNF = "()";
-    std::cout << CNF << std::endl;
-  }
-
-  bool is_unit_clause(const std::string &clause) {
-    std::istringstream iss(clause);
-    std::vector<std::string> literals;
-    std::string literal;
-
-    while (iss >> literal)
-      literals.push_back(literal);
-
-    return literals.size() == 1;
-  }
-
-  void removeUnitfromClauses(std::vector<std::string> &cnf,
-                             const std::string &unit) {
-    for (auto &clause : cnf) {
-      std::istringstream iss(clause);
-      std::vector<std::string> words;
-      std::string word;
-
-      while (iss >> word) {
-        if (word != unit) {
-          // Only keep the word if it's not the unit
-          words.push_back(word);
-        }
-      }
-
-      std::ostringstream oss;
-      for (size_t i = 0; i < words.size(); ++i) {
-        if (i > 0) {
-          oss << " ";
-        }
-        oss << words[i];
-      }
-
-      clause = oss.str();
+    if (!resume_file.empty()) {
+      Partial resumed;
+      if (!read_partial(resume_file, cnf, resumed))
+        return 1;
+      for (Lit lit : resumed.units)
+        cnf.add_clause({lit});
+      phases = resumed.assign;
     }
-  }
-
-  void deleteClause(std::vector<std::string> &cnf, const std::string &unit) {
-    cnf.erase(std::remove_if(cnf.begin(), cnf.end(),
-                             [&unit](const std::string &clause) {
-                               std::istringstream iss(clause);
-                               std::string word;
-                               while (iss >> word) {
-                                 // if the unit is found in the clause, remove
-                                 // the clause
-                                 if (word == unit) {
-                                   return true;
-                                 }
-                               }
-                               return false;
-                             }),
-              cnf.end());
-  }
-
-  void find_pureLiterals(std::vector<std::string> cnf,
-                         std::vector<std::string> &pureLiterals) {
-    std::unordered_map<std::string, int> posLiteralCount;
-    std::unordered_map<std::string, int> negLiteralCount;
-
-    for (const auto &clause : cnf) {
-      std::istringstream iss(clause);
-      std::string literal;
-      while (iss >> literal) {
-        if (literal[0] == '~') {
-          negLiteralCount[literal.substr(1)]++;
-        } else {
-          posLiteralCount[literal]++;
-        }
-      }
+    if (!proof_file.empty()) {
+      if (!proof.open(proof_file, cnf))
+        return 1;
+      logging = true;
+      preprocess = false;
     }
 
-    for (const auto &literal : posLiteralCount) {
-      if (literal.second > 0 && negLiteralCount[literal.first] == 0) {
-        // to prevent unit clause from being added to pureLiterals
-        if (std::find(pureLiterals.begin(), pureLiterals.end(),
-                      literal.first) == pureLiterals.end())
-          pureLiterals.push_back(literal.first);
-      }
+    Preprocessor preprocessor;
+    bool consistent = true;
+    if (preprocess) {
+      PhaseTimer timer(stats.preprocess);
+      consistent = preprocessor.run(cnf);
+      std::clog << "Preprocessing: " << preprocessor.n_fixed << " fixed, "
+                << preprocessor.n_eliminated << " eliminated, "
+                << cnf.num_clauses() << " clauses left" << std::endl;
     }
 
-    for (const auto &literal : negLiteralCount) {
-      if (literal.second > 0 && posLiteralCount[literal.first] == 0) {
-        if (std::find(pureLiterals.begin(), pureLiterals.end(),
-                      "~" + literal.first) == pureLiterals.end())
-          pureLiterals.push_back("~" + literal.first);
+    config.restarts = restarts;
+    std::vector<signed char> model;
+    Stats search_stats;
+    Partial partial;
+    Progress progress;
+    progress.start();
+    Result result = UNKNOWN;
+    if (consistent && local_flips > 0) {
+      PhaseTimer timer(stats.search);
+      LocalSearch search;
+      search.load(cnf);
+      if (search.solve(local_flips, local_flips)) {
+        result = SATISFIABLE;
+        model = search.assign;
       }
+      phases = search.best;
     }
-  }
-
-  bool solve(std::vector<std::string> cnf, std::set<std::string> literals) {
-    std::vector<std::string> new_t, new_f;
-    n_decs++;
-    std::clog << "\rDecision: " << n_decs << std::flush;
-
-    // remove duplicate clauses
-    std::sort(cnf.begin(), cnf.end());
-    cnf.erase(std::unique(cnf.begin(), cnf.end()), cnf.end());
-
-    // find unit clauses
-    std::vector<std::string> units;
-    std::copy_if(
-        cnf.begin(), cnf.end(), std::back_inserter(units),
-        [this](const std::string &clause) { return is_unit_clause(clause); });
 
-    // find pure literals
-    find_pureLiterals(cnf, units);
-
-    // if there are unit clauses
-    if (!units.empty()) {
-      for (const auto &unit : units) {
-        n_prop++;
-        // if the unit is a negation
-        if (unit[0] == '~') {
-          new_f.push_back(unit.substr(1));
-          assign_f.insert(unit.substr(1));
-          // remove the clauses with the unit
-          deleteClause(cnf, unit);
-          // remove the negation from clauses
-          removeUnitfromClauses(cnf, unit.substr(1));
-        } else {
-          new_t.push_back(unit);
-          assign_t.insert(unit);
-          // remove the clauses with the unit
-          deleteClause(cnf, unit);
-          // remove the unit from the clauses
-          removeUnitfromClauses(cnf, '~' + unit);
-        }
-      }
-    }
-
-    // if the cnf is empty, return true
-    if (cnf.empty())
-      return true;
-    // if there is an empty clause, return false
-    if (std::any_of(cnf.begin(), cnf.end(),
-                    [](const std::string &clause) { return clause.empty(); })) {
-      // remove the assignments
-      for (std::string literal : new_t)
-        assign_t.erase(literal);
-      for (std::string literal : new_f)
-        assign_f.erase(literal);
-      return false;
+    if (!consistent) {
+      result = UNSATISFIABLE;
+    } else if (result == SATISFIABLE) {
+      // already solved by the local search
+    } else if (n_workers > 1) {
+      result = portfolio(n_workers, model, search_stats, progress, partial);
+    } else {
+      CDCL engine;
+      engine.config = config;
+      engine.report(&progress);
+      if (budget.limited())
+        engine.limit(&budget);
+      if (logging)
+        engine.solver.proof = &proof;
+      bool loaded = engine.load(cnf);
+      engine.set_phases(phases);
+      result = loaded ? engine.solve() : UNSATISFIABLE;
+      model = engine.model;
+      search_stats = engine.stats();
+      if (result == UNKNOWN)
+        keep(engine, partial);
     }
+    progress.stop();
+    proof.close();
+    stats += search_stats;
 
-    literals.clear();
-    for (const auto &clause : cnf) {
-      std::istringstream iss(clause);
-      std::string literal;
-
-      while (iss >> literal) {
-        if (literal[0] == '~')
-          literals.insert(literal.substr(1));
-        else
-          literals.insert(literal);
-      }
+    if (result == SATISFIABLE) {
+      preprocessor.extend(model);
+      write_model("output_dpll.txt", cnf, model);
     }
-
-    if (!literals.empty()) {
-      std::string literal = decision(literals);
-      std::vector<std::string> new_cnf = cnf;
-      new_cnf.push_back(literal);
-
-      if (solve(new_cnf, literals))
-        return true;
-
-      new_cnf = cnf;
-      new_cnf.push_back("~" + literal);
-      if (solve(new_cnf, literals))
-        return true;
-
-      std::vector<std::string> learned_clause = {
-          (literal[0] == '~') ? literal.substr(1) : "~" + literal};
-      update_scores(learned_clause);
+    std::cout << std::endl;
+    if (result == UNKNOWN) {
+      std::cout << "s UNKNOWN" << std::endl;
+      std::cout << "Budget exhausted: " << budget.describe() << std::endl;
+      if (!dump_file.empty() && write_partial(dump_file, cnf, partial))
+        std::cout << "Partial assignment written to " << dump_file
+                  << std::endl;
+    } else {
+      write_solution(std::cout, result == SATISFIABLE, cnf, model);
     }
-
-    for (std::string literal : new_t)
-      assign_t.erase(literal);
-    for (std::string literal : new_f)
-      assign_f.erase(literal);
-    return false;
+    if (result == SATISFIABLE)
+      std::cout << "Solution written output_dpll.txt" << std::endl;
+    if (logging)
+      std::cout << "Proof written to " << proof_file << std::endl;
+    stats.print_counters(std::cout);
+    std::cout << "Restarts: " << stats.restarts << std::endl;
+    if (print_stats)
+      stats.print(std::cout);
+    std::cout << std::endl;
+    return result == UNKNOWN ? EXIT_UNKNOWN : 0;
   }
 
-public:
-  void dpll(const std::string &filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-      std::cerr << "Error opening file " << filename << std::endl;
-      return;
+  // lists up to limit models, all of them for 0, as "v" lines. a single
+  // engine finds them one after the other, blocking each one it reports.
+  // with a list of projected variables, only their values are listed, and
+  // each assignment of them once. the preprocessor is skipped, since the
+  // variables it eliminates would be missing from the models
+  void enumerate(const std::string &filename, long long limit,
+                 const std::string &projected,
+                 Restarts restarts = GLUCOSE_RESTARTS,
+                 bool print_stats = false) {
+    Stats stats;
+    {
+      PhaseTimer timer(stats.parse);
+      if (!cnf.load(filename))
+        return;
     }
+    std::vector<int> projection;
+    if (!cnf.lookup(projected, projection))
+      return;
 
-    std::vector<std::string> cnf;
-    std::set<std::string> literals;
-    std::string line;
-
-    while (std::getline(file, line)) {
-      cnf.push_back(line);
-      std::istringstream iss(line);
-      std::string literal;
-
-      while (iss >> literal) {
-        if (literal[0] == '~')
-          literals.insert(literal.substr(1));
-        else
-          literals.insert(literal);
-      }
-    }
-
-    initialize_scores(cnf);
-
-    if (solve(cnf, literals)) {
-      std::cout << "\nResult: SATISFIABLE" << std::endl;
-      std::cout << "Solution written output_dpll.txt" << std::endl;
-      std::ofstream output("output_dpll.txt");
-      for (const auto &literal : assign_t)
-        output << literal << std::endl;
-      for (const auto &literal : assign_f)
-        output << "~" << literal << std::endl;
-      output.close();
-    } else {
-      std::cout << "\nResult: UNSATISFIABLE" << std::endl;
+    config.restarts = restarts;
+    CDCL engine;
+    engine.config = config;
+    long long found = 0;
+    BufferedWriter writer(std::cout);
+    if (engine.load(cnf)) {
+      PhaseTimer timer(stats.search);
+      found = engine.enumerate(
+          {}, limit, projection, [&](const std::vector<signed char> &model) {
+            write_values(writer, cnf, model, projection);
+          });
     }
+    stats += engine.stats();
+
+    writer.write(found > 0 ? "s SATISFIABLE\n" : "s UNSATISFIABLE\n");
+    writer.write("Models: " + std::to_string(found));
+    writer.write(limit > 0 && found == limit ? " (limit reached)\n" : "\n");
+    writer.flush();
+    stats.print_counters(std::cout);
+    if (print_stats)
+      stats.print(std::cout);
     std::cout << std::endl;
   }
 };
 
 int main(int argc, char *argv[]) {
-  if (argc != 2) {
-    std::cerr << "Usage: " << argv[0] << " <input_file>" << std::endl;
+  // --portfolio N races N diversified solvers, 0 means one per core
+  // --restarts luby|glucose|none picks the restart policy
+  // --no-preprocess searches the formula as it is read
+  // --stats prints the time of every phase and the rates at the end
+  // --proof FILE writes a binary DRAT proof
+  // --local-search N runs N flips of local search before the CDCL search
+  // --enumerate N lists up to N models, all of them for 0
+  // --project LIST lists only the variables of LIST, names separated by
+  //   commas, and each assignment of them once
+  // --time-limit S, --conflict-limit N, --decision-limit N and
+  //   --memory-limit MB stop the search for a model with "s UNKNOWN" and
+  //   the exit status EXIT_UNKNOWN once one of them is reached
+  // --dump FILE writes what a search stopped that way leaves to FILE
+  // --resume FILE starts from what a stopped search left in FILE
+  long long local_flips = 0, limit = -1;
+  int n_workers = 1;
+  Restarts restarts = GLUCOSE_RESTARTS;
+  bool preprocess = true, print_stats = false;
+  std::string proof_file, projected, dump_file, resume_file;
+  DPLL solver;
+  int arg = 1;
+  for (; arg < argc - 1; arg++) {
+    std::string option = argv[arg];
+    std::string value = (arg + 2 < argc) ? argv[arg + 1] : "";
+    if (option == "--no-preprocess") {
+      preprocess = false;
+      continue;
+    }
+    if (option == "--stats") {
+      print_stats = true;
+      continue;
+    }
+    if (option == "--portfolio" && !value.empty()) {
+      n_workers = std::atoi(value.c_str());
+      if (n_workers <= 0)
+        n_workers = std::max(1u, std::thread::hardware_concurrency());
+    } else if (option == "--restarts" && value == "luby") {
+      restarts = LUBY_RESTARTS;
+    } else if (option == "--restarts" && value == "glucose") {
+      restarts = GLUCOSE_RESTARTS;
+    } else if (option == "--restarts" && value == "none") {
+      restarts = NO_RESTARTS;
+    } else if (option == "--proof" && !value.empty()) {
+      proof_file = value;
+    } else if (option == "--local-search" && std::atoll(value.c_str()) > 0) {
+      local_flips = std::atoll(value.c_str());
+    } else if (option == "--enumerate" && std::atoll(value.c_str()) >= 0) {
+      limit = std::atoll(value.c_str());
+    } else if (option == "--project" && !value.empty()) {
+      projected = value;
+    } else if (option == "--time-limit" && std::atof(value.c_str()) > 0) {
+      solver.budget.seconds = std::atof(value.c_str());
+    } else if (option == "--conflict-limit" &&
+               std::atoll(value.c_str()) > 0) {
+      solver.budget.conflicts = std::atoll(value.c_str());
+    } else if (option == "--decision-limit" &&
+               std::atoll(value.c_str()) > 0) {
+      solver.budget.decisions = std::atoll(value.c_str());
+    } else if (option == "--memory-limit" && std::atoll(value.c_str()) > 0) {
+      solver.budget.megabytes = std::atoll(value.c_str());
+    } else if (option == "--dump" && !value.empty()) {
+      dump_file = value;
+    } else if (option == "--resume" && !value.empty()) {
+      resume_file = value;
+    } else {
+      break;
+    }
+    arg++;
+  }
+  if (arg != argc - 1) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--portfolio N] [--restarts luby|glucose|none]"
+              << " [--no-preprocess] [--stats] [--proof FILE]"
+              << " [--local-search N] [--enumerate N [--project LIST]]"
+              << " [--time-limit S] [--conflict-limit N]"
+              << " [--decision-limit N] [--memory-limit MB] [--dump FILE]"
+              << " [--resume FILE] <input_file>" << std::endl;
+    return 1;
+  }
+  // the units of a resumed search are new input clauses to a proof checker
+  if (!proof_file.empty() && !resume_file.empty()) {
+    std::cerr << "--proof cannot be used with --resume" << std::endl;
     return 1;
   }
 
-  DPLL solver;
-  solver.dpll(argv[1]);
-
-  return 0;
+  if (limit >= 0) {
+    solver.enumerate(argv[arg], limit, projected, restarts, print_stats);
+    return 0;
+  }
+  return solver.dpll(argv[arg], n_workers, restarts, preprocess, print_stats,
+                     proof_file, local_flips, dump_file, resume_file);
 }
@@ -0,0 +1,740 @@
+#ifndef CDCL_H
+#define CDCL_H
+
+#include "exchange.h"
+#include "heap.h"
+#include "solver.h"
+#include "stats.h"
+
+enum Result { UNSATISFIABLE, SATISFIABLE, UNKNOWN };
+
+// NO_RESTARTS never restarts, LUBY_RESTARTS restarts after luby(i) *
+// luby_unit conflicts, and GLUCOSE_RESTARTS restarts when the LBD of the
+// recent learned clauses is well above the average of the whole run
+enum Restarts { NO_RESTARTS, LUBY_RESTARTS, GLUCOSE_RESTARTS };
+
+// parameters that portfolio workers vary to search differently
+struct Config {
+  unsigned seed = 0;           // 0 keeps the activities as initialized
+  double var_decay = 0.95;     // VSIDS decay
+  double random_freq = 0.0;    // fraction of decisions on a random variable
+  bool negative_phase = false; // phase of variables never assigned before
+  Restarts restarts = GLUCOSE_RESTARTS;
+  int luby_unit = 100;
+};
+
+// conflict driven clause learning engine. it can be used incrementally:
+// clauses may be added between calls to solve, each call may assume some
+// literals, and learned clauses are kept from one call to the next
+class CDCL {
+private:
+  const CNF *cnf = nullptr;
+  std::mt19937 rng;
+
+  // VSIDS: variables in learned clauses get their activity bumped by
+  // var_inc, which grows by 1 / var_decay after every conflict so that older
+  // bumps count less. activities are rescaled only when they get too large
+  std::vector<double> activity;
+  VarHeap order;
+  double var_inc = 1.0;
+
+  std::vector<char> seen;
+  std::vector<Lit> stack, to_clear;
+  std::vector<int> level_stamp;
+  int stamp = 0;
+
+  // the learned clauses are reduced every reduce_base + n * reduce_inc
+  // conflicts
+  const int reduce_base = 2000, reduce_inc = 300;
+  long long next_reduce = reduce_base;
+  int n_reduces = 0;
+
+  // the counters and phase times, and the part of them not yet added to
+  // the progress totals
+  Stats counters;
+  Progress *progress = nullptr;
+  Stats flushed;
+
+  // restarts: conflicts since the last one, the position in the luby
+  // sequence, and for the glucose policy the LBDs of the last
+  // glucose_window learned clauses, in a ring of which n_recent slots have
+  // been filled since the restart, next to the LBD sum of the whole run
+  int restart_conflicts = 0;
+  int luby_index = 0;
+  static constexpr size_t glucose_window = 50;
+  std::array<int, glucose_window> recent_lbd{};
+  size_t n_recent = 0;
+  long long recent_lbd_sum = 0, total_lbd_sum = 0;
+  const double glucose_margin = 0.8;
+
+  // portfolio clause sharing: learned clauses with at most share_size
+  // literals or an LBD of at most share_lbd are published, and the clauses
+  // of the other workers are imported at level 0 on each restart, or every
+  // import_interval conflicts when restarts are off
+  ClauseExchange *exchange = nullptr;
+  const std::atomic<bool> *stop = nullptr;
+  int id = 0;
+  uint64_t cursor = 0;
+  std::vector<Lit> imported; // the clause being imported
+  const int share_size = 2, share_lbd = 2;
+  const int import_interval = 1000;
+  long long next_import = import_interval;
+
+  // the limits the search gives up at, shared with the other workers, and
+  // the counts charged to them. best_size is the size of best
+  Budget *budget = nullptr;
+  Stats charged;
+  size_t best_size = 0;
+
+  // selector variables of finished enumerations, free to be used again
+  std::vector<int> free_selectors;
+
+  // initialize the activities to the frequency of the variables in the
+  // clauses, with a little noise when a seed is set to break ties
+  // differently
+  void initialize_scores(const CNF &formula) {
+    for (Lit lit : formula.lits)
+      activity[var_of(lit)] += 1.0;
+    if (config.seed != 0) {
+      std::uniform_real_distribution<double> noise(0.0, 0.5);
+      for (double &act : activity)
+        act += noise(rng);
+    }
+    order.init(&activity);
+  }
+
+  // makes room for the variables below n, the random generator is seeded
+  // when the first variables are created
+  void ensure_vars(int n) {
+    int old = solver.num_vars();
+    if (n <= old)
+      return;
+    if (old == 0)
+      rng.seed(config.seed);
+    solver.grow(n);
+    activity.resize(n, 0.0);
+    seen.resize(n, 0);
+    level_stamp.resize(n + 1, 0);
+    if (old == 0) {
+      order.init(&activity);
+    } else {
+      order.grow(n);
+    }
+  }
+
+  // choose the unassigned variable with maximum activity, -1 if all the
+  // variables are assigned. assigned variables popped here are put back by
+  // backtrack
+  int decision() {
+    if (config.random_freq > 0 && solver.num_vars() > 0 &&
+        std::uniform_real_distribution<double>(0, 1)(rng) <
+            config.random_freq) {
+      int var = rng() % solver.num_vars();
+      if (solver.assign[var] == 0)
+        return var;
+    }
+    while (!order.empty()) {
+      int var = order.pop();
+      if (solver.assign[var] == 0)
+        return var;
+    }
+    return -1;
+  }
+
+  // bump the variables in the learned clause, then decay all the
+  // activities by raising the increment
+  void update_scores(const std::vector<Lit> &learned_clause) {
+    for (Lit lit : learned_clause)
+      bump_variable(var_of(lit));
+
+    counters.conflicts++;
+    var_inc /= config.var_decay;
+  }
+
+  void bump_variable(int var) {
+    activity[var] += var_inc;
+    if (activity[var] > 1e100) {
+      for (double &act : activity)
+        act *= 1e-100;
+      var_inc *= 1e-100;
+    }
+    order.increased(var);
+  }
+
+  // undo the assignments above the level and make their variables
+  // available for decisions again
+  void backtrack(int target) {
+    if (solver.decision_level() <= target)
+      return;
+    for (size_t i = solver.trail_lim[target]; i < solver.trail.size(); i++)
+      order.insert(var_of(solver.trail[i]));
+    solver.backtrack(target);
+  }
+
+  void print_cnf() {
+    std::string CNF;
+    // parse through the clauses that are not satisfied yet
+    for (int cref : solver.clauses) {
+      if (solver.cardinality(cref))
+        continue;
+      std::string clause;
+      Lit *c = solver.lits(cref);
+      bool satisfied = false;
+      for (int k = 0; k < solver.size(cref); k++) {
+        if (solver.value(c[k]) > 0)
+          satisfied = true;
+        if (solver.value(c[k]) != 0)
+          continue;
+        if (!clause.empty())
+          clause += " ";
+        clause += cnf ? cnf->lit_name(c[k])
+                      : (is_neg(c[k]) ? "~" : "") + std::to_string(var_of(c[k]));
+      }
+      // if the clause is not empty, add it to the string
+      if (!satisfied && !clause.empty())
+        CNF += "(" + clause + ")";
+    }
+    // if the string is empty, add an empty clause
+    if (CNF.empty())
+      CNF = "()";
+    std::cout << CNF << std::endl;
+  }
+
+  // walks the implication graph back from the conflict until a single
+  // literal of the current level is left (the first UIP). the learned clause
+  // has the negation of that literal first and the literal of the highest
+  // remaining level second, which is the level to backjump to
+  void analyze(int conflict, std::vector<Lit> &learned_clause,
+               int &backjump_level) {
+    int pending = 0;
+    Lit p = -1;
+    size_t index = solver.trail.size();
+    learned_clause.assign(1, -1);
+
+    do {
+      if (solver.learnt(conflict))
+        solver.bump_clause(conflict);
+
+      int n;
+      const Lit *c = solver.explain(conflict, p, n);
+      // the first literal of a reason clause is the one it implied
+      for (int k = (p < 0) ? 0 : 1; k < n; k++) {
+        int var = var_of(c[k]);
+        if (seen[var] || solver.level[var] == 0)
+          continue;
+        seen[var] = 1;
+        if (solver.level[var] >= solver.decision_level())
+          pending++;
+        else
+          learned_clause.push_back(c[k]);
+      }
+
+      // the next literal of the current level to resolve on
+      while (!seen[var_of(solver.trail[--index])])
+        ;
+      p = solver.trail[index];
+      conflict = solver.reason[var_of(p)];
+      seen[var_of(p)] = 0;
+      pending--;
+    } while (pending > 0);
+    learned_clause[0] = negate(p);
+
+    minimize(learned_clause);
+
+    backjump_level = 0;
+    if (learned_clause.size() > 1) {
+      size_t max_k = 1;
+      for (size_t k = 2; k < learned_clause.size(); k++)
+        if (solver.level[var_of(learned_clause[k])] >
+            solver.level[var_of(learned_clause[max_k])])
+          max_k = k;
+      std::swap(learned_clause[1], learned_clause[max_k]);
+      backjump_level = solver.level[var_of(learned_clause[1])];
+    }
+  }
+
+  // removes the literals implied by the other literals of the learned
+  // clause, then clears the seen flags
+  void minimize(std::vector<Lit> &learned_clause) {
+    // levels of the clause as a bitmask, to give up early on literals that
+    // depend on a level the clause does not contain
+    unsigned levels = 0;
+    for (size_t k = 1; k < learned_clause.size(); k++)
+      levels |= 1u << (solver.level[var_of(learned_clause[k])] & 31);
+
+    to_clear.assign(learned_clause.begin(), learned_clause.end());
+    size_t kept = 1;
+    for (size_t k = 1; k < learned_clause.size(); k++) {
+      if (solver.reason[var_of(learned_clause[k])] == Solver::NO_REASON ||
+          !redundant(learned_clause[k], levels))
+        learned_clause[kept++] = learned_clause[k];
+    }
+    learned_clause.resize(kept);
+
+    for (Lit lit : to_clear)
+      seen[var_of(lit)] = 0;
+  }
+
+  // checks if every path from the literal back to the decisions goes
+  // through a literal of the learned clause
+  bool redundant(Lit lit, unsigned levels) {
+    stack.assign(1, lit);
+    size_t top = to_clear.size();
+    while (!stack.empty()) {
+      Lit implied = negate(stack.back());
+      stack.pop_back();
+      int n;
+      const Lit *c =
+          solver.explain(solver.reason[var_of(implied)], implied, n);
+      for (int k = 1; k < n; k++) {
+        int var = var_of(c[k]);
+        if (seen[var] || solver.level[var] == 0)
+          continue;
+        if (solver.reason[var] != Solver::NO_REASON &&
+            (levels >> (solver.level[var] & 31) & 1)) {
+          seen[var] = 1;
+          stack.push_back(c[k]);
+          to_clear.push_back(c[k]);
+        } else {
+          // undo the marks of this failed attempt
+          for (size_t i = top; i < to_clear.size(); i++)
+            seen[var_of(to_clear[i])] = 0;
+          to_clear.resize(top);
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // number of distinct decision levels in a clause
+  int compute_lbd(const std::vector<Lit> &clause) {
+    stamp++;
+    int lbd = 0;
+    for (Lit lit : clause) {
+      int lvl = solver.level[var_of(lit)];
+      if (level_stamp[lvl] != stamp) {
+        level_stamp[lvl] = stamp;
+        lbd++;
+      }
+    }
+    return lbd;
+  }
+
+  // adds a clause at level 0. the literals already false are dropped and a
+  // clause already satisfied is skipped. returns false if nothing is left.
+  // a learnt clause, one shared by another engine, goes to the proof
+  bool add_simplified(std::vector<Lit> &clause, bool learnt, int lbd = 0) {
+    size_t kept = 0;
+    for (Lit lit : clause) {
+      if (solver.value(lit) > 0)
+        return true;
+      if (solver.value(lit) == 0)
+        clause[kept++] = lit;
+    }
+    clause.resize(kept);
+    if (learnt && solver.proof)
+      solver.proof->add(clause);
+
+    if (clause.empty())
+      return solver.ok = false;
+    if (clause.size() == 1)
+      solver.enqueue(clause[0], Solver::NO_REASON);
+    else
+      solver.attach(clause, learnt, std::min<int>(lbd, clause.size()));
+    return true;
+  }
+
+  // collects the assumptions that led to the given assumption being false,
+  // by walking back the reasons of its negation p
+  void analyze_final(Lit p) {
+    failed.assign(1, negate(p));
+    if (solver.decision_level() == 0)
+      return;
+    seen[var_of(p)] = 1;
+    for (size_t i = solver.trail.size(); i-- > (size_t)solver.trail_lim[0];) {
+      int var = var_of(solver.trail[i]);
+      if (!seen[var])
+        continue;
+      int cref = solver.reason[var];
+      if (cref == Solver::NO_REASON) {
+        // only assumptions are decided below the assumption levels
+        failed.push_back(solver.trail[i]);
+      } else {
+        int n;
+        const Lit *c = solver.explain(cref, solver.trail[i], n);
+        for (int k = 1; k < n; k++)
+          if (solver.level[var_of(c[k])] > 0)
+            seen[var_of(c[k])] = 1;
+      }
+      seen[var] = 0;
+    }
+    seen[var_of(p)] = 0;
+  }
+
+  // adds the counts since the last flush to the progress totals
+  void flush() {
+    Stats now = stats();
+    progress->add(now.decisions - flushed.decisions,
+                  now.propagations - flushed.propagations,
+                  now.conflicts - flushed.conflicts);
+    flushed = now;
+  }
+
+  // finite subsequence of the luby sequence 1 1 2 1 1 2 4 1 1 2 ...
+  static double luby(int i) {
+    int size = 1, seq = 0;
+    while (size < i + 1) {
+      seq++;
+      size = 2 * size + 1;
+    }
+    while (size - 1 != i) {
+      size = (size - 1) >> 1;
+      seq--;
+      i = i % size;
+    }
+    return std::pow(2.0, seq);
+  }
+
+  // records the LBD of a new learned clause for the glucose policy
+  void record_lbd(int lbd) {
+    restart_conflicts++;
+    total_lbd_sum += lbd;
+    int &slot = recent_lbd[n_recent % glucose_window];
+    if (n_recent++ >= glucose_window)
+      recent_lbd_sum -= slot;
+    slot = lbd;
+    recent_lbd_sum += lbd;
+  }
+
+  bool should_restart() {
+    switch (config.restarts) {
+    case LUBY_RESTARTS:
+      return restart_conflicts >= luby(luby_index) * config.luby_unit;
+    case GLUCOSE_RESTARTS:
+      return n_recent >= glucose_window &&
+             recent_lbd_sum * glucose_margin / glucose_window >
+                 (double)total_lbd_sum / counters.conflicts;
+    default:
+      return false;
+    }
+  }
+
+  void restart() {
+    counters.restarts++;
+    restart_conflicts = 0;
+    luby_index++;
+    n_recent = 0;
+    recent_lbd_sum = 0;
+    backtrack(0);
+  }
+
+  // goes back to level 0 and takes in the clauses shared since last time,
+  // returns false if they make the formula unsatisfiable
+  bool import_clauses() {
+    backtrack(0);
+    bool consistent = true;
+    exchange->collect(id, cursor, imported,
+                      [this, &consistent](std::vector<Lit> &clause, int lbd) {
+                        if (consistent && !add_simplified(clause, true, lbd))
+                          consistent = false;
+                      });
+    return consistent;
+  }
+
+public:
+  Solver solver;
+  Config config;
+
+  std::vector<signed char> model; // variable -> value after SATISFIABLE
+  // the decisions the model follows from, after SATISFIABLE, without the
+  // assumptions
+  std::vector<Lit> model_decisions;
+  std::vector<Lit> failed; // assumptions in conflict after UNSATISFIABLE
+  // with a budget, the assignment with the most variables set at a
+  // conflict, the phases to resume a search stopped by it from
+  std::vector<signed char> best;
+
+  // copies the clause database into the engine
+  bool load(const CNF &formula) {
+    cnf = &formula;
+    ensure_vars(formula.num_vars());
+    initialize_scores(formula);
+    for (int c = 0; c < formula.num_clauses() && solver.ok; c++)
+      add_clause(std::vector<Lit>(formula.begin(c), formula.end(c)));
+    return solver.ok;
+  }
+
+  // adds a clause between calls to solve, creating the variables it uses.
+  // returns false once the clauses are unsatisfiable
+  bool add_clause(std::vector<Lit> clause) {
+    if (!solver.ok)
+      return false;
+    std::sort(clause.begin(), clause.end());
+    clause.erase(std::unique(clause.begin(), clause.end()), clause.end());
+    for (size_t k = 1; k < clause.size(); k++)
+      if (clause[k] == negate(clause[k - 1]))
+        return true;
+    if (!clause.empty())
+      ensure_vars(var_of(clause.back()) + 1);
+    return add_simplified(clause, false);
+  }
+
+  // adds the constraint that at most bound of the literals are true, which
+  // is propagated natively instead of as clauses. with add_clause on the
+  // same literals it makes an exactly-one constraint
+  bool add_at_most(std::vector<Lit> lits, int bound) {
+    if (!solver.ok)
+      return false;
+    std::sort(lits.begin(), lits.end());
+    lits.erase(std::unique(lits.begin(), lits.end()), lits.end());
+    // one of a literal and its negation is always true
+    size_t kept = 0;
+    for (size_t k = 0; k < lits.size(); k++) {
+      if (k + 1 < lits.size() && lits[k + 1] == negate(lits[k])) {
+        bound--;
+        k++;
+      } else {
+        lits[kept++] = lits[k];
+      }
+    }
+    lits.resize(kept);
+    if (!lits.empty())
+      ensure_vars(var_of(lits.back()) + 1);
+    return solver.add_at_most(lits, bound);
+  }
+
+  // counters of the search so far
+  Stats stats() const {
+    Stats result = counters;
+    result.propagations = solver.n_prop;
+    return result;
+  }
+
+  // adds the counters to the totals of a progress line from now on
+  void report(Progress *totals) {
+    progress = totals;
+    flushed = stats();
+  }
+
+  // value of a variable in the model: 1 true, -1 false
+  int value(int var) const { return model[var]; }
+
+  // sets the phases the variables are first decided with, for example from
+  // an assignment found by local search
+  void set_phases(const std::vector<signed char> &phases) {
+    for (size_t var = 0; var < phases.size() && var < solver.phase.size();
+         var++)
+      solver.phase[var] = phases[var];
+  }
+
+  // gives up the search with UNKNOWN once the budget is spent, keeping
+  // track of the fullest assignment reached in best meanwhile
+  void limit(Budget *shared) { budget = shared; }
+
+  // takes part in a portfolio: learned clauses are shared through the
+  // exchange, and the search gives up once stop is set
+  void join(int worker, ClauseExchange *shared, const std::atomic<bool> *flag) {
+    id = worker;
+    exchange = shared;
+    stop = flag;
+  }
+
+  // searches for a model in which the assumptions hold. after
+  // UNSATISFIABLE, failed holds the assumptions responsible, and is empty if
+  // the clauses are unsatisfiable on their own. the engine is back at level
+  // 0 when it returns, ready for more clauses
+  Result solve(const std::vector<Lit> &assumptions = {}) {
+    model.clear();
+    failed.clear();
+    if (!solver.ok) {
+      if (solver.proof)
+        solver.proof->add({});
+      return UNSATISFIABLE;
+    }
+    for (Lit lit : assumptions)
+      ensure_vars(var_of(lit) + 1);
+    Result result;
+    {
+      PhaseTimer timer(counters.search);
+      result = search(assumptions);
+    }
+    if (progress)
+      flush();
+    if (result == UNSATISFIABLE && failed.empty()) {
+      solver.ok = false;
+      if (solver.proof)
+        solver.proof->add({});
+    }
+    backtrack(0);
+    return result;
+  }
+
+  // finds up to limit models in which the assumptions hold, all of them
+  // for limit 0, one after the other, and calls report on each. each model
+  // is excluded from the next calls to solve by a blocking clause: the
+  // negation of its decisions, or of the values of the projected variables
+  // when projection is not empty, in which case models only differing
+  // outside of it are found once. the blocking clauses also hold the
+  // negation of a selector variable, which is assumed while enumerating.
+  // at the end the blocking clauses, and the clauses learned from them,
+  // which all hold the negated selector, are deleted and the selector is
+  // kept for the next call, so the engine can go on being used
+  // incrementally without growing. returns the number of models found
+  long long enumerate(
+      const std::vector<Lit> &assumptions, long long limit,
+      const std::vector<int> &projection,
+      const std::function<void(const std::vector<signed char> &)> &report) {
+    std::vector<Lit> assumed = assumptions, blocking;
+    int selector = -1;
+    long long found = 0;
+    while (solve(assumed) == SATISFIABLE) {
+      found++;
+      report(model);
+      if (limit > 0 && found >= limit)
+        break;
+      if (selector < 0 && !free_selectors.empty()) {
+        selector = free_selectors.back();
+        free_selectors.pop_back();
+        assumed.push_back(make_lit(selector, false));
+      } else if (selector < 0) {
+        selector = solver.num_vars();
+        ensure_vars(selector + 1);
+        assumed.push_back(make_lit(selector, false));
+      }
+      blocking.assign(1, make_lit(selector, true));
+      if (projection.empty()) {
+        for (Lit lit : model_decisions)
+          blocking.push_back(negate(lit));
+      } else {
+        for (int var : projection)
+          blocking.push_back(make_lit(var, model[var] > 0));
+      }
+      add_clause(blocking);
+    }
+    if (selector >= 0) {
+      solver.remove_variable(selector);
+      order.insert(selector);
+      free_selectors.push_back(selector);
+    }
+    return found;
+  }
+
+private:
+  // conflict driven clause learning: every conflict is analyzed into a
+  // learned clause that is added to the formula, and the search jumps back
+  // to the level where that clause becomes unit. the assumptions are the
+  // first decisions
+  Result search(const std::vector<Lit> &assumptions) {
+    std::vector<Lit> learned_clause;
+
+    while (true) {
+      if (stop && stop->load(std::memory_order_relaxed))
+        return UNKNOWN;
+      if (budget && budget->spent(counters, charged))
+        return UNKNOWN;
+
+      int conflict;
+      {
+        PhaseTimer timer(counters.propagate);
+        conflict = solver.propagate();
+      }
+      if (conflict != Solver::NO_REASON) {
+        // a conflict without decisions means the formula is unsatisfiable
+        if (solver.decision_level() == 0)
+          return UNSATISFIABLE;
+        if (budget && solver.trail.size() > best_size) {
+          best_size = solver.trail.size();
+          best = solver.assign;
+        }
+
+        PhaseTimer timer(counters.analyze);
+        int backjump_level;
+        analyze(conflict, learned_clause, backjump_level);
+        backtrack(backjump_level);
+
+        int lbd = compute_lbd(learned_clause);
+        if (solver.proof)
+          solver.proof->add(learned_clause);
+        if (learned_clause.size() == 1) {
+          solver.enqueue(learned_clause[0], Solver::NO_REASON);
+        } else {
+          int cref = solver.attach(learned_clause, true, lbd);
+          solver.bump_clause(cref);
+          solver.enqueue(learned_clause[0], cref);
+        }
+        if (exchange && ((int)learned_clause.size() <= share_size ||
+                         lbd <= share_lbd))
+          exchange->publish(id, learned_clause, lbd);
+
+        update_scores(learned_clause);
+        record_lbd(lbd);
+        solver.decay_clauses();
+        continue;
+      }
+
+      if (should_restart()) {
+        PhaseTimer timer(counters.restart);
+        restart();
+        if (exchange && !import_clauses())
+          return UNSATISFIABLE;
+        continue;
+      }
+
+      // periodically drop the less useful learned clauses
+      if (counters.conflicts >= next_reduce) {
+        PhaseTimer timer(counters.restart);
+        next_reduce =
+            counters.conflicts + reduce_base + reduce_inc * ++n_reduces;
+        solver.reduce_db();
+      }
+
+      if (exchange && config.restarts == NO_RESTARTS &&
+          counters.conflicts >= next_import &&
+          exchange->available(cursor)) {
+        PhaseTimer timer(counters.restart);
+        next_import = counters.conflicts + import_interval;
+        if (!import_clauses())
+          return UNSATISFIABLE;
+        continue;
+      }
+
+      // decide the next assumption, an assumption that already holds gets
+      // an empty level so that levels and assumptions stay aligned
+      Lit next = -1;
+      while (solver.decision_level() < (int)assumptions.size()) {
+        Lit p = assumptions[solver.decision_level()];
+        if (solver.value(p) > 0) {
+          solver.new_decision_level();
+        } else if (solver.value(p) < 0) {
+          analyze_final(negate(p));
+          return UNSATISFIABLE;
+        } else {
+          next = p;
+          break;
+        }
+      }
+
+      if (next < 0) {
+        int var = decision();
+        if (var < 0) {
+          model = solver.assign;
+          model_decisions.clear();
+          for (size_t k = assumptions.size(); k < solver.trail_lim.size(); k++)
+            model_decisions.push_back(solver.trail[solver.trail_lim[k]]);
+          return SATISFIABLE;
+        }
+
+        if (++counters.decisions % Progress::FLUSH_INTERVAL == 0 && progress)
+          flush();
+        // phase saving: reuse the value the variable had last
+        bool negative = solver.phase[var] ? solver.phase[var] < 0
+                                          : config.negative_phase;
+        next = make_lit(var, negative);
+      }
+      solver.decide(next);
+    }
+  }
+};
+
+#endif
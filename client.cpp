@@ -0,0 +1,127 @@
+#include "output.h"
+#include "protocol.h"
+#include "stats.h"
+
+// a drop-in for ./cdcl that has a running ./daemon solve the formula: it
+// sends the file as it is, or in the binary framing with --binary, and
+// prints the answer the way ./cdcl does, writing the model to
+// output_dpll.txt. a pipeline of many small formulas then pays for a
+// connection per formula instead of a solver start and a parse, and with
+// --no-file the model is only printed, on the "v" lines. the exit status is
+// the one of ./cdcl: EXIT_UNKNOWN for "s UNKNOWN", 1 on an error
+int main(int argc, char *argv[]) {
+  // --socket PATH reaches the daemon at PATH, DEFAULT_SOCKET by default
+  // --timeout S gives up after S seconds with "s UNKNOWN"
+  // --binary sends the formula in the binary framing, for a DIMACS input
+  // --no-file does not write output_dpll.txt
+  std::string path = DEFAULT_SOCKET;
+  double timeout = 0;
+  bool binary = false, model_file = true;
+  int arg = 1;
+  for (; arg < argc - 1; arg++) {
+    std::string option = argv[arg];
+    std::string value = (arg + 2 < argc) ? argv[arg + 1] : "";
+    if (option == "--binary") {
+      binary = true;
+      continue;
+    }
+    if (option == "--no-file") {
+      model_file = false;
+      continue;
+    }
+    if (option == "--socket" && !value.empty())
+      path = value;
+    else if (option == "--timeout" && std::atof(value.c_str()) > 0)
+      timeout = std::atof(value.c_str());
+    else
+      break;
+    arg++;
+  }
+  if (arg != argc - 1) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--socket PATH] [--timeout S] [--binary] [--no-file]"
+              << " <input_file>" << std::endl;
+    return 1;
+  }
+
+  std::string filename = argv[arg];
+  std::ifstream input(filename, std::ios::binary);
+  if (!input) {
+    std::cerr << "Error opening file " << filename << std::endl;
+    return 1;
+  }
+  std::string formula((std::istreambuf_iterator<char>(input)),
+                      std::istreambuf_iterator<char>());
+  if (binary) {
+    CNF cnf;
+    if (!cnf.parse(formula.data(), formula.data() + formula.size())) {
+      std::cerr << "Error parsing file " << filename << std::endl;
+      return 1;
+    }
+    for (int var = 0; var < cnf.num_vars(); var++) {
+      if (cnf.names[var] != std::to_string(var + 1)) {
+        std::cerr << "--binary needs a DIMACS input" << std::endl;
+        return 1;
+      }
+    }
+    formula = cnf.to_binary();
+  }
+
+  int fd = connect_socket(path);
+  if (fd < 0) {
+    std::cerr << "Error connecting to the daemon at " << path << std::endl;
+    return 1;
+  }
+  std::vector<std::string> fields;
+  std::string answer;
+  std::string options = std::string(binary ? "binary" : "dimacs") + " " +
+                        std::to_string((long long)(timeout * 1000));
+  // the answer is read even if sending failed: the daemon refuses a formula
+  // over its limit with an error before closing the connection
+  send_message(fd, "SOLVE", formula, options);
+  bool answered = receive_message(fd, fields, answer);
+  close(fd);
+  if (!answered) {
+    std::cerr << "The daemon at " << path << " did not answer" << std::endl;
+    return 1;
+  }
+  if (fields[0] != "OK") {
+    std::cerr << answer;
+    return 1;
+  }
+
+  // the "s" and "v" lines first, then the counters. the model is read back
+  // from the "v" lines, the names with '-' for the false ones
+  std::istringstream lines(answer);
+  std::string solution, counters;
+  CNF names;
+  std::vector<signed char> model;
+  bool satisfiable = false, unknown = false;
+  for (std::string line; std::getline(lines, line);) {
+    if (line.compare(0, 2, "s ") == 0) {
+      satisfiable = line == "s SATISFIABLE";
+      unknown = line == "s UNKNOWN";
+    } else if (line.compare(0, 2, "v ") == 0) {
+      std::istringstream tokens(line.substr(2));
+      for (std::string token; tokens >> token;) {
+        if (token == "0")
+          continue;
+        bool negative = token[0] == '-';
+        names.intern(negative ? token.substr(1) : token);
+        model.push_back(negative ? -1 : 1);
+      }
+    } else {
+      counters += line + "\n";
+      continue;
+    }
+    solution += line + "\n";
+  }
+
+  std::cout << std::endl << solution;
+  if (satisfiable && model_file) {
+    write_model("output_dpll.txt", names, model);
+    std::cout << "Solution written output_dpll.txt" << std::endl;
+  }
+  std::cout << counters << std::endl;
+  return unknown ? EXIT_UNKNOWN : 0;
+}
@@ -0,0 +1,516 @@
+#ifndef CNF_H
+#define CNF_H
+
+#include <bits/stdc++.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// a literal is packed as 2 * var + sign, where sign is 1 for a negation
+typedef int Lit;
+
+inline Lit make_lit(int var, bool neg) { return 2 * var + (neg ? 1 : 0); }
+inline int var_of(Lit lit) { return lit >> 1; }
+inline bool is_neg(Lit lit) { return lit & 1; }
+inline Lit negate(Lit lit) { return lit ^ 1; }
+
+// a file mapped read-only into memory, unmapped when it goes away. an empty
+// file has no data
+struct MappedFile {
+  const char *data = nullptr;
+  size_t size = 0;
+
+  bool open(const std::string &filename) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+      std::cerr << "Error opening file " << filename << std::endl;
+      if (fd >= 0)
+        close(fd);
+      return false;
+    }
+    size = st.st_size;
+    if (size == 0) {
+      close(fd);
+      return true;
+    }
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+      std::cerr << "Error reading file " << filename << std::endl;
+      size = 0;
+      return false;
+    }
+    data = static_cast<const char *>(mapped);
+    return true;
+  }
+
+  ~MappedFile() {
+    if (data)
+      munmap((void *)data, size);
+  }
+};
+
+// a 64 bit hash of a text, eight bytes at a time, to tell whether a cache
+// was made from it. far cheaper than parsing the text, but not meant to
+// resist a forged input
+inline uint64_t content_hash(const char *data, size_t size) {
+  const uint64_t prime = 0x9e3779b97f4a7c15ull;
+  uint64_t hash = size * prime;
+  size_t k = 0;
+  for (; k + 8 <= size; k += 8) {
+    uint64_t word;
+    std::memcpy(&word, data + k, 8);
+    hash = (hash ^ word) * prime;
+    hash ^= hash >> 29;
+  }
+  uint64_t tail = 0;
+  if (k < size)
+    std::memcpy(&tail, data + k, size - k);
+  hash = (hash ^ tail) * prime;
+  return hash ^ (hash >> 32);
+}
+
+// clause database shared by the solvers. variable names are interned once
+// while loading, and every clause lives in one contiguous literal arena.
+class CNF {
+public:
+  std::vector<std::string> names; // variable -> name
+  // name -> variable, filled on first use after a load from a cache
+  mutable std::unordered_map<std::string, int> index;
+  std::vector<Lit> lits;     // all clauses, back to back
+  std::vector<int> start{0}; // clause c is lits[start[c]..start[c + 1])
+  // a header or a literal with more variables fails the parse, before any
+  // room is made for them. the default keeps every literal in an int
+  long long max_vars = INT_MAX / 2;
+
+  int num_vars() const { return names.size(); }
+  int num_clauses() const { return start.size() - 1; }
+  int size(int c) const { return start[c + 1] - start[c]; }
+  const Lit *begin(int c) const { return lits.data() + start[c]; }
+  const Lit *end(int c) const { return lits.data() + start[c + 1]; }
+
+  // returns the variable for a name, creating it on first sight
+  int intern(const std::string &name) {
+    index_names();
+    auto it = index.find(name);
+    if (it != index.end())
+      return it->second;
+    int var = names.size();
+    names.push_back(name);
+    index.emplace(name, var);
+    return var;
+  }
+
+  // the variable of a name, -1 if it is not in the formula
+  int find(const std::string &name) const {
+    index_names();
+    auto it = index.find(name);
+    return it == index.end() ? -1 : it->second;
+  }
+
+  // the variables of a list of names separated by commas, sorted. false if
+  // one of them is not in the formula
+  bool lookup(const std::string &list, std::vector<int> &vars) const {
+    std::istringstream iss(list);
+    for (std::string name; std::getline(iss, name, ',');) {
+      if (name.empty())
+        continue;
+      int var = find(name);
+      if (var < 0) {
+        std::cerr << "Unknown variable " << name << std::endl;
+        return false;
+      }
+      vars.push_back(var);
+    }
+    std::sort(vars.begin(), vars.end());
+    vars.erase(std::unique(vars.begin(), vars.end()), vars.end());
+    return true;
+  }
+
+  std::string lit_name(Lit lit) const {
+    return (is_neg(lit) ? "~" : "") + names[var_of(lit)];
+  }
+
+  // appends a clause, dropping repeated literals. tautologies are skipped.
+  void add_clause(const std::vector<Lit> &clause) {
+    lits.insert(lits.end(), clause.begin(), clause.end());
+    end_clause();
+  }
+
+  // closes the clause made of the literals appended to the arena since the
+  // last clause. without literals, there is only a clause to close when
+  // keep_empty is set: DIMACS writes the empty clause as a lone 0, which
+  // makes the formula unsatisfiable, where a blank line is no clause
+  void end_clause(bool keep_empty = false) {
+    auto first = lits.begin() + start.back();
+    if (first == lits.end()) {
+      if (keep_empty)
+        start.push_back(lits.size());
+      return;
+    }
+    std::sort(first, lits.end());
+    lits.erase(std::unique(first, lits.end()), lits.end());
+    for (auto it = first + 1; it < lits.end(); it++) {
+      if (*it == negate(*(it - 1))) {
+        lits.resize(start.back());
+        return;
+      }
+    }
+    start.push_back(lits.size());
+  }
+
+  // maps the file and reads it: a cache file written by save_cache, or a
+  // formula in one of the formats of parse. the cache next to a formula,
+  // its name followed by ".cache", is read instead of the text when it was
+  // made from the same text, which is checked with a hash of the text
+  bool load(const std::string &filename) {
+    MappedFile file;
+    if (!file.open(filename))
+      return false;
+    if (is_cache(file.data, file.size)) {
+      if (read_cache(file.data, file.size))
+        return true;
+      std::cerr << "Error reading cache " << filename << std::endl;
+      return false;
+    }
+
+    MappedFile cache;
+    struct stat st;
+    std::string cache_name = filename + ".cache";
+    if (stat(cache_name.c_str(), &st) == 0 && cache.open(cache_name) &&
+        is_cache(cache.data, cache.size)) {
+      uint64_t hash = content_hash(file.data, file.size);
+      if (read_cache(cache.data, cache.size, &hash, file.size))
+        return true;
+      std::clog << "Cache " << cache_name << " is out of date, parsing "
+                << filename << std::endl;
+    }
+
+    madvise((void *)file.data, file.size, MADV_SEQUENTIAL);
+    bool parsed = parse(file.data, file.data + file.size);
+    if (!parsed)
+      std::cerr << "Error parsing file " << filename << std::endl;
+    return parsed;
+  }
+
+  // writes the formula as a cache file, for the text of text_size bytes
+  // with the given content hash. it is written under a temporary name and
+  // then renamed, so that a solver loading it never sees half of it
+  bool save_cache(const std::string &filename, uint64_t hash,
+                  uint64_t text_size) const {
+    CacheHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof header.magic);
+    header.version = CACHE_VERSION;
+    header.num_vars = num_vars();
+    header.hash = hash;
+    header.text_size = text_size;
+    header.num_clauses = num_clauses();
+    header.num_lits = lits.size();
+    std::vector<uint32_t> offsets{0};
+    std::string name_bytes;
+    for (const std::string &name : names) {
+      name_bytes += name;
+      offsets.push_back(name_bytes.size());
+    }
+    header.name_bytes = name_bytes.size();
+    name_bytes.resize((name_bytes.size() + 3) & ~(size_t)3, '\0');
+
+    std::string temporary = filename + ".tmp" + std::to_string(getpid());
+    FILE *file = fopen(temporary.c_str(), "wb");
+    if (!file) {
+      std::cerr << "Error opening file " << temporary << std::endl;
+      return false;
+    }
+    bool written =
+        fwrite(&header, sizeof header, 1, file) == 1 &&
+        fwrite(offsets.data(), sizeof(uint32_t), offsets.size(), file) ==
+            offsets.size() &&
+        fwrite(name_bytes.data(), 1, name_bytes.size(), file) ==
+            name_bytes.size() &&
+        fwrite(start.data(), sizeof(int), start.size(), file) ==
+            start.size() &&
+        fwrite(lits.data(), sizeof(Lit), lits.size(), file) == lits.size();
+    written = (fclose(file) == 0) && written;
+    if (!written || rename(temporary.c_str(), filename.c_str()) != 0) {
+      std::cerr << "Error writing file " << filename << std::endl;
+      unlink(temporary.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  // parses a formula in one of two formats:
+  //  - DIMACS, recognized by its "p cnf <vars> <clauses>" header. lines
+  //    starting with 'c' are comments, literals are non-zero integers with
+  //    '-' for a negation and each clause ends with 0, possibly on a later
+  //    line, a lone 0 being the empty clause. the header sizes are used to
+  //    preallocate the storage.
+  //  - one clause per line, literals are names with '~' for a negation.
+  //    lines starting with 'c' before the first clause are comments, a
+  //    variable may be named c afterwards.
+  // in both, blank lines are ignored and a '%' token ends the formula. the
+  // header is a 'p' followed by "cnf", a variable may be named p too.
+  bool parse(const char *p, const char *end) {
+    bool dimacs = false;
+    bool line_start = true;
+    bool in_clauses = false; // a literal has been read
+
+    while (p < end) {
+      char ch = *p;
+      if (ch == '\n') {
+        if (!dimacs)
+          end_clause();
+        line_start = true;
+        p++;
+        continue;
+      }
+      if (ch == ' ' || ch == '\t' || ch == '\r') {
+        p++;
+        continue;
+      }
+
+      const char *token = p;
+      while (p < end && !std::isspace((unsigned char)*p))
+        p++;
+      size_t length = p - token;
+
+      bool comment = ch == 'c' && (dimacs || !in_clauses);
+      if (line_start && length == 1 && (comment || is_header(p, end))) {
+        if (ch == 'p') {
+          if (!read_header(p, end))
+            return false;
+          dimacs = true;
+        }
+        // skip the rest of the line
+        while (p < end && *p != '\n')
+          p++;
+        continue;
+      }
+      line_start = false;
+      in_clauses = true;
+
+      if (length == 1 && ch == '%')
+        break;
+
+      if (dimacs) {
+        long long number;
+        if (!parse_int(token, p, number))
+          return false;
+        if (number == 0) {
+          end_clause(true);
+          continue;
+        }
+        long long var = std::llabs(number);
+        if (var > max_vars)
+          return false;
+        while (num_vars() < var)
+          intern(std::to_string(num_vars() + 1));
+        lits.push_back(make_lit(var - 1, number < 0));
+      } else if (ch == '~') {
+        lits.push_back(make_lit(intern(std::string(token + 1, p)), true));
+      } else {
+        lits.push_back(make_lit(intern(std::string(token, p)), false));
+      }
+    }
+    end_clause();
+    return true;
+  }
+
+  // the binary framing of a formula: 32 bit integers in the byte order of
+  // the machine, the number of variables and of clauses, then the clauses
+  // as in DIMACS, literals -(var + 1) or var + 1 and a 0 after each clause.
+  // the variables are only numbered, so a formula keeps its names only if
+  // it was read from DIMACS
+  std::string to_binary() const {
+    std::vector<int32_t> words;
+    words.reserve(2 + lits.size() + num_clauses());
+    words.push_back(num_vars());
+    words.push_back(num_clauses());
+    for (int c = 0; c < num_clauses(); c++) {
+      for (const Lit *lit = begin(c); lit != end(c); lit++)
+        words.push_back(is_neg(*lit) ? -(var_of(*lit) + 1) : var_of(*lit) + 1);
+      words.push_back(0);
+    }
+    return std::string(reinterpret_cast<const char *>(words.data()),
+                       words.size() * sizeof(int32_t));
+  }
+
+  // reads a formula in the binary framing of to_binary
+  bool parse_binary(const char *p, const char *end) {
+    size_t n_words = (end - p) / sizeof(int32_t);
+    if ((end - p) % sizeof(int32_t) != 0 || n_words < 2)
+      return false;
+    std::vector<int32_t> words(n_words);
+    std::memcpy(words.data(), p, n_words * sizeof(int32_t));
+    if (words[0] < 0 || words[1] < 0 || words[0] > max_vars)
+      return false;
+    names.reserve(words[0]);
+    index.reserve(words[0]);
+    // every clause takes a word at least, whatever the header says
+    start.reserve(std::min<size_t>(words[1], n_words) + 1);
+    lits.reserve(n_words - 2);
+    while (num_vars() < words[0])
+      intern(std::to_string(num_vars() + 1));
+    for (size_t k = 2; k < n_words; k++) {
+      int32_t number = words[k];
+      if (number == 0) {
+        end_clause(true);
+        continue;
+      }
+      if (number == INT32_MIN)
+        return false;
+      int var = std::abs(number);
+      if (var > max_vars)
+        return false;
+      while (num_vars() < var)
+        intern(std::to_string(num_vars() + 1));
+      lits.push_back(make_lit(var - 1, number < 0));
+    }
+    end_clause();
+    return true;
+  }
+
+private:
+  // adds the names not in index yet, those of a load from a cache
+  void index_names() const {
+    if (index.size() == names.size())
+      return;
+    index.reserve(names.size());
+    for (int var = 0; var < num_vars(); var++)
+      index.emplace(names[var], var);
+  }
+
+  // the layout of a cache file: this header, the num_vars + 1 offsets of
+  // the variable names in the name bytes, the name bytes padded to a
+  // multiple of 4, then start and lits as they are in memory
+  struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_vars;
+    uint64_t hash;      // of the text the cache was made from
+    uint64_t text_size; // in bytes
+    uint64_t num_clauses;
+    uint64_t num_lits;
+    uint64_t name_bytes;
+  };
+  static constexpr char CACHE_MAGIC[8] = {'C', 'N', 'F', 'C',
+                                          'A', 'C', 'H', 'E'};
+  static constexpr uint32_t CACHE_VERSION = 2;
+
+  static bool is_cache(const char *data, size_t size) {
+    return size >= sizeof(CacheHeader) &&
+           std::memcmp(data, CACHE_MAGIC, sizeof CACHE_MAGIC) == 0;
+  }
+
+  // fills the formula from a cache file, copying its arrays as they are.
+  // with a hash, only a cache made from a text of that hash and size is
+  // read. false, with the formula untouched, if the cache does not fit
+  bool read_cache(const char *data, size_t size,
+                  const uint64_t *hash = nullptr, uint64_t text_size = 0) {
+    CacheHeader header;
+    std::memcpy(&header, data, sizeof header);
+    if (header.version != CACHE_VERSION ||
+        (hash && (header.hash != *hash || header.text_size != text_size)))
+      return false;
+    // the sizes are checked against the file before anything is allocated
+    // for them, in 64 bits and each under the file size so that the sum
+    // cannot wrap around. UINT32_MAX variables would wrap the offsets
+    uint64_t num_vars = header.num_vars;
+    if (num_vars > INT_MAX / 2 || header.num_clauses > size ||
+        header.num_lits > size || header.name_bytes > size)
+      return false;
+    uint64_t padded = (header.name_bytes + 3) & ~(uint64_t)3;
+    uint64_t expected = sizeof header + 4 * (num_vars + 1) + padded +
+                        4 * (header.num_clauses + 1) + 4 * header.num_lits;
+    if (size != expected)
+      return false;
+
+    const char *p = data + sizeof header;
+    std::vector<uint32_t> offsets(num_vars + 1);
+    std::memcpy(offsets.data(), p, 4 * offsets.size());
+    p += 4 * offsets.size();
+    const char *name_bytes = p;
+    p += padded;
+    std::vector<int> new_start(header.num_clauses + 1);
+    std::memcpy(new_start.data(), p, 4 * new_start.size());
+    p += 4 * new_start.size();
+    std::vector<Lit> new_lits(header.num_lits);
+    std::memcpy(new_lits.data(), p, 4 * new_lits.size());
+
+    // a damaged cache must not send the solvers out of bounds
+    if (new_start[0] != 0 || (uint64_t)new_start.back() != header.num_lits ||
+        !std::is_sorted(new_start.begin(), new_start.end()) ||
+        offsets[0] != 0 || offsets.back() != header.name_bytes ||
+        !std::is_sorted(offsets.begin(), offsets.end()))
+      return false;
+    for (Lit lit : new_lits)
+      if (lit < 0 || var_of(lit) >= (int)num_vars)
+        return false;
+
+    // hashing every name costs more than the rest of the load, and the
+    // solvers rarely look one up, so the index waits for intern or lookup
+    names.clear();
+    index.clear();
+    names.reserve(num_vars);
+    for (uint64_t var = 0; var < num_vars; var++)
+      names.emplace_back(name_bytes + offsets[var],
+                         offsets[var + 1] - offsets[var]);
+    start = std::move(new_start);
+    lits = std::move(new_lits);
+    return true;
+  }
+
+  static bool parse_int(const char *p, const char *end, long long &number) {
+    bool neg = (p < end && *p == '-');
+    if (neg)
+      p++;
+    if (p == end)
+      return false;
+    number = 0;
+    for (; p < end; p++) {
+      if (*p < '0' || *p > '9')
+        return false;
+      number = number * 10 + (*p - '0');
+    }
+    if (neg)
+      number = -number;
+    return true;
+  }
+
+  // whether the 'p' ending at p, at the start of a line, begins a header
+  static bool is_header(const char *p, const char *end) {
+    if (p[-1] != 'p')
+      return false;
+    while (p < end && (*p == ' ' || *p == '\t'))
+      p++;
+    return end - p >= 3 && std::strncmp(p, "cnf", 3) == 0 &&
+           (end - p == 3 || std::isspace((unsigned char)p[3]));
+  }
+
+  // reads "cnf <vars> <clauses>" after the 'p' of a header, and names the
+  // variables 1 to <vars>
+  bool read_header(const char *p, const char *end) {
+    const char *line_end = std::find(p, end, '\n');
+    std::istringstream iss(std::string(p, line_end));
+    std::string format;
+    long long vars, clauses;
+    if (!(iss >> format >> vars >> clauses) || format != "cnf" || vars < 0 ||
+        clauses < 0 || vars > max_vars)
+      return false;
+
+    names.reserve(vars);
+    index.reserve(vars);
+    // every clause takes two bytes at least, whatever the header says
+    clauses = std::min<long long>(clauses, (end - p) / 2);
+    start.reserve(clauses + 1);
+    // most of the inputs we see are 3-SAT
+    lits.reserve(3 * clauses);
+    while (num_vars() < vars)
+      intern(std::to_string(num_vars() + 1));
+    return true;
+  }
+};
+
+#endif
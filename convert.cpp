@@ -0,0 +1,31 @@
+#include "cnf.h"
+
+// writes the cache of a formula: the parsed clauses and variable names in
+// the binary layout of CNF::save_cache. by default the cache goes next to
+// the formula, as <input_file>.cache, where the solvers pick it up by
+// themselves as long as the formula is not changed; given another output
+// file, it is loaded by passing that file to the solvers
+int main(int argc, char *argv[]) {
+  if (argc != 2 && argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " <input_file> [<cache_file>]"
+              << std::endl;
+    return 1;
+  }
+  std::string input = argv[1];
+  std::string output = argc == 3 ? argv[2] : input + ".cache";
+
+  MappedFile file;
+  if (!file.open(input))
+    return 1;
+  CNF cnf;
+  if (!cnf.parse(file.data, file.data + file.size)) {
+    std::cerr << "Error parsing file " << input << std::endl;
+    return 1;
+  }
+  if (!cnf.save_cache(output, content_hash(file.data, file.size), file.size))
+    return 1;
+  std::cout << "Cache of " << input << " written to " << output << ": "
+            << cnf.num_vars() << " variables, " << cnf.num_clauses()
+            << " clauses" << std::endl;
+  return 0;
+}
@@ -0,0 +1,319 @@
+#ifndef COUNT_H
+#define COUNT_H
+
+#include "solver.h"
+
+// an unsigned integer of any size, since model counts soon outgrow 64 bits:
+// 32 bit limbs, the least significant first, without leading zeros
+class Count {
+private:
+  std::vector<uint32_t> limbs;
+
+  void trim() {
+    while (!limbs.empty() && limbs.back() == 0)
+      limbs.pop_back();
+  }
+
+public:
+  Count(uint64_t value = 0) {
+    for (; value; value >>= 32)
+      limbs.push_back((uint32_t)value);
+  }
+
+  bool is_zero() const { return limbs.empty(); }
+
+  Count &operator+=(const Count &other) {
+    if (limbs.size() < other.limbs.size())
+      limbs.resize(other.limbs.size(), 0);
+    uint64_t carry = 0;
+    for (size_t k = 0; k < limbs.size(); k++) {
+      carry += limbs[k];
+      if (k < other.limbs.size())
+        carry += other.limbs[k];
+      limbs[k] = (uint32_t)carry;
+      carry >>= 32;
+    }
+    if (carry)
+      limbs.push_back((uint32_t)carry);
+    return *this;
+  }
+
+  Count operator*(const Count &other) const {
+    Count product;
+    if (is_zero() || other.is_zero())
+      return product;
+    product.limbs.assign(limbs.size() + other.limbs.size(), 0);
+    for (size_t i = 0; i < limbs.size(); i++) {
+      uint64_t carry = 0;
+      for (size_t j = 0; j < other.limbs.size(); j++) {
+        carry += (uint64_t)limbs[i] * other.limbs[j] + product.limbs[i + j];
+        product.limbs[i + j] = (uint32_t)carry;
+        carry >>= 32;
+      }
+      product.limbs[i + other.limbs.size()] = (uint32_t)carry;
+    }
+    product.trim();
+    return product;
+  }
+
+  // multiplies by 2^bits
+  Count &shift(int bits) {
+    if (is_zero())
+      return *this;
+    limbs.insert(limbs.begin(), bits / 32, 0);
+    int rest = bits % 32;
+    if (rest) {
+      uint32_t carry = 0;
+      for (uint32_t &limb : limbs) {
+        uint32_t high = limb >> (32 - rest);
+        limb = (limb << rest) | carry;
+        carry = high;
+      }
+      if (carry)
+        limbs.push_back(carry);
+    }
+    return *this;
+  }
+
+  // the number in decimal, divided into base 10^9 digits first
+  std::string str() const {
+    if (is_zero())
+      return "0";
+    std::vector<uint32_t> rest = limbs, digits;
+    while (!rest.empty()) {
+      uint64_t remainder = 0;
+      for (size_t k = rest.size(); k-- > 0;) {
+        uint64_t current = (remainder << 32) | rest[k];
+        rest[k] = current / 1000000000;
+        remainder = current % 1000000000;
+      }
+      digits.push_back(remainder);
+      while (!rest.empty() && rest.back() == 0)
+        rest.pop_back();
+    }
+    std::string text = std::to_string(digits.back());
+    for (size_t k = digits.size() - 1; k-- > 0;) {
+      std::string digit = std::to_string(digits[k]);
+      text += std::string(9 - digit.size(), '0') + digit;
+    }
+    return text;
+  }
+};
+
+// exact model counting: a DPLL search that adds up the models of both
+// branches of every decision instead of stopping at the first one. what is
+// left of the formula under the decisions keeps falling apart into
+// components that share no variable, whose counts multiply, so each one is
+// counted on its own; and the count of a component is cached under its
+// variables and open clauses, since the search meets the same component
+// again under other decisions. with a projection, an assignment of the
+// projected variables counts once if it extends to a model: they are
+// decided first, and a component without any left only needs one model
+class ModelCounter {
+private:
+  // a component: its unassigned variables and the clauses not yet
+  // satisfied, by index in solver.clauses, both sorted
+  struct Component {
+    std::vector<int> vars, clauses;
+  };
+
+  struct KeyHash {
+    size_t operator()(const std::vector<int> &key) const {
+      uint64_t hash = 14695981039346656037ull;
+      for (int x : key) {
+        hash ^= (uint32_t)x;
+        hash *= 1099511628211ull;
+      }
+      return hash;
+    }
+  };
+
+  Solver solver;
+  std::vector<char> projected;     // variable -> counted
+  std::vector<int> occ_start, occ; // variable -> indices of its clauses
+  std::vector<int> parent, label;  // union-find of split
+  std::vector<int> visited;        // clause -> stamp of the last split
+  int stamp = 0;
+  std::vector<int> open;           // the open clauses seen by split
+
+  // component -> count, the key is the variables, -1 and the clauses. it
+  // is emptied when the keys reach CACHE_LIMIT integers
+  std::unordered_map<std::vector<int>, Count, KeyHash> cache;
+  size_t cache_size = 0;
+
+  // the components of the unassigned variables of vars, which must be
+  // closed under the open clauses, in the order of their lowest variable.
+  // free counts the projected variables left in no open clause, which can
+  // take either value
+  void split(const std::vector<int> &vars, std::vector<Component> &parts,
+             int &free) {
+    auto find = [this](int var) {
+      while (parent[var] != var)
+        var = parent[var] = parent[parent[var]];
+      return var;
+    };
+    for (int var : vars)
+      parent[var] = -1;
+
+    stamp++;
+    open.clear();
+    for (int var : vars) {
+      if (solver.assign[var] != 0)
+        continue;
+      for (int k = occ_start[var]; k < occ_start[var + 1]; k++) {
+        int index = occ[k];
+        if (visited[index] == stamp)
+          continue;
+        visited[index] = stamp;
+        int cref = solver.clauses[index];
+        const Lit *c = solver.lits(cref);
+        int n = solver.size(cref);
+        if (std::any_of(c, c + n,
+                        [this](Lit lit) { return solver.value(lit) > 0; }))
+          continue;
+        open.push_back(index);
+        int root = -1;
+        for (int i = 0; i < n; i++) {
+          int other = var_of(c[i]);
+          if (solver.assign[other] != 0)
+            continue;
+          if (parent[other] < 0)
+            parent[other] = other;
+          int r = find(other);
+          if (root < 0)
+            root = r;
+          else if (r != root)
+            parent[r] = root;
+        }
+      }
+    }
+
+    parts.clear();
+    free = 0;
+    for (int var : vars)
+      if (solver.assign[var] == 0 && parent[var] >= 0)
+        label[find(var)] = -1;
+    for (int var : vars) {
+      if (solver.assign[var] != 0)
+        continue;
+      if (parent[var] < 0) {
+        free += projected[var];
+        continue;
+      }
+      int &part = label[find(var)];
+      if (part < 0) {
+        part = parts.size();
+        parts.emplace_back();
+      }
+      parts[part].vars.push_back(var);
+    }
+    for (int index : open) {
+      const Lit *c = solver.lits(solver.clauses[index]);
+      while (solver.assign[var_of(*c)] != 0)
+        c++;
+      parts[label[find(var_of(*c))]].clauses.push_back(index);
+    }
+    for (Component &part : parts)
+      std::sort(part.clauses.begin(), part.clauses.end());
+  }
+
+  // the product of the counts of the components of vars
+  Count count_vars(const std::vector<int> &vars) {
+    std::vector<Component> parts;
+    int free;
+    split(vars, parts, free);
+    Count total(1);
+    total.shift(free);
+    for (const Component &part : parts) {
+      total = total * count_component(part);
+      if (total.is_zero())
+        break;
+    }
+    return total;
+  }
+
+  // branches on the projected variable of the component with the most
+  // clauses, or on any variable when none is projected. without a
+  // projected variable the count is 0 or 1, so the second branch is only
+  // tried when the first one has no model
+  Count count_component(const Component &part) {
+    std::vector<int> key = part.vars;
+    key.push_back(-1);
+    key.insert(key.end(), part.clauses.begin(), part.clauses.end());
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+      cache_hits++;
+      return it->second;
+    }
+
+    int var = -1, best = -1;
+    for (int other : part.vars) {
+      int score = occ_start[other + 1] - occ_start[other];
+      if (projected[other])
+        score += (int)occ.size() + 1;
+      if (score > best) {
+        best = score;
+        var = other;
+      }
+    }
+    bool exists = !projected[var];
+    Count result;
+    for (bool neg : {false, true}) {
+      decisions++;
+      solver.decide(make_lit(var, neg));
+      if (solver.propagate() == Solver::NO_REASON)
+        result += count_vars(part.vars);
+      solver.backtrack(solver.decision_level() - 1);
+      if (exists && !result.is_zero())
+        break;
+    }
+
+    if (cache_size + key.size() > CACHE_LIMIT) {
+      cache.clear();
+      cache_size = 0;
+    }
+    cache_size += key.size();
+    cache.emplace(std::move(key), result);
+    return result;
+  }
+
+public:
+  static constexpr size_t CACHE_LIMIT = 1 << 26;
+
+  long long decisions = 0, cache_hits = 0;
+
+  // the number of models of the formula, or of assignments of the
+  // projected variables that extend to one, every variable being projected
+  // when projection is empty
+  Count count(const CNF &cnf, const std::vector<int> &projection = {}) {
+    if (!solver.load(cnf) || solver.propagate() != Solver::NO_REASON)
+      return Count(0);
+    int n = solver.num_vars();
+    projected.assign(n, projection.empty());
+    for (int var : projection)
+      projected[var] = 1;
+
+    occ_start.assign(n + 1, 0);
+    for (int cref : solver.clauses)
+      for (int k = 0; k < solver.size(cref); k++)
+        occ_start[var_of(solver.lits(cref)[k]) + 1]++;
+    for (int var = 0; var < n; var++)
+      occ_start[var + 1] += occ_start[var];
+    occ.resize(occ_start.back());
+    std::vector<int> fill(occ_start.begin(), occ_start.end() - 1);
+    for (size_t index = 0; index < solver.clauses.size(); index++) {
+      int cref = solver.clauses[index];
+      for (int k = 0; k < solver.size(cref); k++)
+        occ[fill[var_of(solver.lits(cref)[k])]++] = index;
+    }
+    parent.resize(n);
+    label.resize(n);
+    visited.assign(solver.clauses.size(), 0);
+
+    std::vector<int> all(n);
+    std::iota(all.begin(), all.end(), 0);
+    return count_vars(all);
+  }
+};
+
+#endif
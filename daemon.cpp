@@ -0,0 +1,293 @@
+#include "cdcl.h"
+#include "output.h"
+#include "preprocess.h"
+#include "protocol.h"
+#include <csignal>
+
+// sets the stop flag of a search once its time is up. one thread keeps the
+// time of all the requests, sleeping until the nearest deadline
+class Watchdog {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+private:
+  struct Alarm {
+    Clock::time_point deadline;
+    std::atomic<bool> *flag;
+    bool fired;
+  };
+
+  std::mutex mtx;
+  std::condition_variable wake;
+  std::list<Alarm> alarms;
+  bool running = true;
+  std::thread timer;
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (running) {
+      Clock::time_point now = Clock::now(), next = Clock::time_point::max();
+      for (Alarm &alarm : alarms) {
+        if (alarm.fired)
+          continue;
+        if (alarm.deadline <= now) {
+          alarm.flag->store(true);
+          alarm.fired = true;
+        } else {
+          next = std::min(next, alarm.deadline);
+        }
+      }
+      if (next == Clock::time_point::max())
+        wake.wait(lock);
+      else
+        wake.wait_until(lock, next);
+    }
+  }
+
+public:
+  typedef std::list<Alarm>::iterator Entry;
+
+  Watchdog() : timer(&Watchdog::run, this) {}
+
+  ~Watchdog() {
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      running = false;
+    }
+    wake.notify_one();
+    timer.join();
+  }
+
+  // sets flag after the given time, until disarmed
+  Entry arm(std::chrono::milliseconds timeout, std::atomic<bool> *flag) {
+    std::lock_guard<std::mutex> lock(mtx);
+    alarms.push_back({Clock::now() + timeout, flag, false});
+    wake.notify_one();
+    return std::prev(alarms.end());
+  }
+
+  void disarm(Entry entry) {
+    std::lock_guard<std::mutex> lock(mtx);
+    alarms.erase(entry);
+  }
+};
+
+// a long-lived solver: it listens on a UNIX domain socket and answers the
+// formulas sent in the framing of protocol.h, so that a pipeline of many
+// small instances pays neither a process start nor a file for each one.
+// the connections are served by a pool of workers, one connection at a time
+// each, so a client keeping its connection open keeps its worker. each
+// formula is preprocessed and solved by a single engine, as by ./cdcl, and
+// the answer, the model included, goes back on the connection
+class Daemon {
+private:
+  int listener = -1;
+  Watchdog watchdog;
+  std::mutex mtx;
+  std::condition_variable ready;
+  std::deque<int> connections; // accepted, waiting for a worker
+  size_t max_body;              // the largest formula accepted, in bytes
+
+  // solves a formula and writes the answer as ./cdcl prints it, with
+  // "s UNKNOWN" once timeout_ms have passed since the request came in.
+  // false with the error message if the formula cannot be read, or if
+  // anything else goes wrong: a bad request must not take down the daemon
+  // and the other connections with it
+  bool solve(const std::string &format, const std::string &formula,
+             long long timeout_ms, std::string &answer) {
+    std::atomic<bool> stop{false};
+    Watchdog::Entry alarm;
+    if (timeout_ms > 0)
+      alarm = watchdog.arm(std::chrono::milliseconds(timeout_ms), &stop);
+    bool solved;
+    try {
+      solved = solve(format, formula, stop, answer);
+    } catch (const std::exception &e) {
+      answer = std::string("Error solving the formula: ") + e.what() + "\n";
+      solved = false;
+    }
+    if (timeout_ms > 0)
+      watchdog.disarm(alarm);
+    return solved;
+  }
+
+  // a formula may have as many variables as its body has bytes, or
+  // MIN_VARS, so that a few bytes cannot make room for billions of them
+  static constexpr long long MIN_VARS = 1 << 20;
+
+  bool solve(const std::string &format, const std::string &formula,
+             std::atomic<bool> &stop, std::string &answer) {
+    CNF cnf;
+    cnf.max_vars = std::max<long long>(formula.size(), MIN_VARS);
+    const char *begin = formula.data(), *end = begin + formula.size();
+    bool parsed = false;
+    if (format == "dimacs")
+      parsed = cnf.parse(begin, end);
+    else if (format == "binary")
+      parsed = cnf.parse_binary(begin, end);
+    if (!parsed) {
+      answer = "Error parsing the formula, which may have at most " +
+               std::to_string(cnf.max_vars) + " variables\n";
+      return false;
+    }
+
+    Stats stats;
+    CDCL engine;
+    engine.join(0, nullptr, &stop);
+    Preprocessor preprocessor;
+    Result result = UNSATISFIABLE;
+    {
+      PhaseTimer timer(stats.search);
+      if (preprocessor.run(cnf) && engine.load(cnf))
+        result = engine.solve();
+    }
+    stats += engine.stats();
+
+    std::ostringstream out;
+    if (result == UNKNOWN) {
+      out << "s UNKNOWN" << std::endl;
+    } else {
+      if (result == SATISFIABLE)
+        preprocessor.extend(engine.model);
+      write_solution(out, result == SATISFIABLE, cnf, engine.model);
+    }
+    stats.print_counters(out);
+    out << "Restarts: " << stats.restarts << std::endl;
+    answer = out.str();
+    return true;
+  }
+
+  // answers the requests of a connection until the client closes it
+  void serve(int fd) {
+    std::vector<std::string> fields;
+    std::string body, answer;
+    while (true) {
+      if (!receive_message(fd, fields, body, max_body)) {
+        // the header of a formula over the limit, whose body is not read
+        if (!fields.empty())
+          send_message(fd, "ERROR",
+                       "Request of " + fields[1] + " bytes over the limit of " +
+                           std::to_string(max_body) + " bytes\n");
+        break;
+      }
+      if (fields[0] != "SOLVE" || fields.size() != 4) {
+        send_message(fd, "ERROR", "Unknown request " + fields[0] + "\n");
+        break;
+      }
+      bool solved = solve(fields[2], body, std::atoll(fields[3].c_str()),
+                          answer);
+      if (!send_message(fd, solved ? "OK" : "ERROR", answer))
+        break;
+    }
+    close(fd);
+  }
+
+  void worker() {
+    while (true) {
+      int fd;
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        ready.wait(lock, [this]() { return !connections.empty(); });
+        fd = connections.front();
+        connections.pop_front();
+      }
+      serve(fd);
+    }
+  }
+
+public:
+  explicit Daemon(size_t max_body) : max_body(max_body) {}
+
+  // binds the socket, refusing to take over the one of a running daemon.
+  // returns false on failure
+  bool listen_on(const std::string &path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+      std::cerr << "Socket path too long: " << path << std::endl;
+      return false;
+    }
+    int running = connect_socket(path);
+    if (running >= 0) {
+      close(running);
+      std::cerr << "A daemon is already listening on " << path << std::endl;
+      return false;
+    }
+    unlink(path.c_str());
+
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, path.c_str());
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 ||
+        bind(listener, (sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(listener, SOMAXCONN) != 0) {
+      std::cerr << "Error listening on " << path << ": "
+                << std::strerror(errno) << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  // accepts connections and hands them to n_workers workers, forever
+  void run(int n_workers) {
+    std::vector<std::thread> workers;
+    for (int id = 0; id < n_workers; id++)
+      workers.emplace_back(&Daemon::worker, this);
+    while (true) {
+      int fd = accept(listener, nullptr, nullptr);
+      if (fd < 0) {
+        if (errno == EINTR || errno == ECONNABORTED)
+          continue;
+        std::cerr << "Error accepting: " << std::strerror(errno) << std::endl;
+        std::exit(1);
+      }
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        connections.push_back(fd);
+      }
+      ready.notify_one();
+    }
+  }
+};
+
+// the socket file, removed when the daemon is stopped
+static std::string socket_path;
+
+int main(int argc, char *argv[]) {
+  // --socket PATH listens on PATH, DEFAULT_SOCKET by default
+  // --workers N serves N connections at a time, one per core by default
+  // --max-body MB refuses the formulas over MB megabytes, 256 by default
+  socket_path = DEFAULT_SOCKET;
+  int n_workers = std::max(1u, std::thread::hardware_concurrency());
+  size_t max_body = DEFAULT_MAX_BODY;
+  int arg = 1;
+  for (; arg + 1 < argc; arg += 2) {
+    std::string option = argv[arg], value = argv[arg + 1];
+    if (option == "--socket")
+      socket_path = value;
+    else if (option == "--workers" && std::atoi(value.c_str()) > 0)
+      n_workers = std::atoi(value.c_str());
+    else if (option == "--max-body" && std::atoll(value.c_str()) > 0)
+      max_body = (size_t)std::atoll(value.c_str()) << 20;
+    else
+      break;
+  }
+  if (arg != argc) {
+    std::cerr << "Usage: " << argv[0] << " [--socket PATH] [--workers N]"
+              << " [--max-body MB]" << std::endl;
+    return 1;
+  }
+
+  Daemon daemon(max_body);
+  if (!daemon.listen_on(socket_path))
+    return 1;
+  auto quit = [](int) {
+    unlink(socket_path.c_str());
+    _exit(0);
+  };
+  std::signal(SIGINT, quit);
+  std::signal(SIGTERM, quit);
+  std::clog << "Listening on " << socket_path << " with " << n_workers
+            << " workers" << std::endl;
+  daemon.run(n_workers);
+  return 0;
+}
@@ -1,290 +1,858 @@
-#include <bits/stdc++.h>
+#include "count.h"
+#include "output.h"
+#include "preprocess.h"
+#include "stats.h"
+
+// a subproblem, given by the decisions that lead to it from the root
+typedef std::vector<Lit> Cube;
+
+// a subproblem of one of the components the formula falls apart into at
+// the root
+struct Job {
+  int component = 0;
+  Cube cube;
+};
+
+// subproblems waiting to be searched. the owner takes the newest one from
+// the back, other workers steal the oldest, usually largest, from the front
+struct WorkQueue {
+  std::mutex mtx;
+  std::deque<Job> jobs;
+};
+
+// a component being searched: the variables it was made of when it was
+// split off at decision level, the index in flipped of the first decision
+// made for it, and the decision level from which to split it again
+struct Frame {
+  int level = 0;
+  size_t first = 0;
+  int next_split = 0;
+  std::vector<int> vars;
+};
+
+// buffers a worker reuses from one subproblem to the next, so that the
+// search does not allocate once they have grown, and its share of the budget
+struct Workspace {
+  // flipped[i] is set once the i-th decision of the subproblem has had both
+  // its branches tried, or its other branch has been given away
+  std::vector<char> flipped;
+  std::vector<Cube> spare; // searched cubes, to donate into
+  static constexpr size_t MAX_SPARE = 64;
+
+  // the nested components being searched, depth of them in use and the
+  // others kept for their buffers
+  std::vector<Frame> frames;
+  size_t depth = 0;
+
+  // union-find over the variables and the result of the last split: the
+  // variables component after component, and where each one starts
+  std::vector<int> parent, label, order, starts;
+  std::vector<int> visited; // clause -> stamp of the last split to see it
+  int stamp = 0;
+
+  // the counts charged to the budget, and with one the assignment with the
+  // most variables set at a conflict, of best_size of them
+  Stats charged;
+  std::vector<signed char> best;
+  size_t best_size = 0;
+};
 
 class DPLL {
 private:
-  std::set<std::string> assign_t, assign_f;
-  std::atomic<int> depth{0};
-  std::atomic<bool> solution_found{false};
+  CNF cnf;
+  std::vector<signed char> assign;
   std::mutex mtx;
 
-  // checks if a clause is a unit clause
-  bool is_unit_clause(const std::string &clause) {
-    std::istringstream iss(clause);
-    std::vector<std::string> literals;
-    std::string literal;
+  // set once every component is solved
+  std::atomic<bool> solution_found{false};
+  // cancellation token shared by all the workers, set with a solution or
+  // when a component turns out to be unsatisfiable
+  std::atomic<bool> stop{false};
+
+  std::deque<WorkQueue> queues;
+  // subproblems queued or being searched, while there are fewer than
+  // workers some of them are idle
+  std::atomic<int> pending{0};
+  // idle workers wait on ready until a subproblem is queued, in any of the
+  // queues since they steal, none is pending any more or the search stops
+  std::mutex idle_mtx;
+  std::condition_variable ready;
+  std::atomic<int> queued{0}; // subproblems in the queues
+
+  // the clauses of every variable, by index in Solver::clauses
+  std::vector<int> occ_start, occ;
+
+  // the components of the formula left at the root, with the subproblems of
+  // each queued or being searched, and whether it has been solved
+  std::vector<std::vector<int>> components;
+  std::deque<std::atomic<int>> open;
+  std::deque<std::atomic<bool>> solved;
+  std::atomic<int> n_solved{0};
+
+  Stats stats; // summed over the workers once they finish
+  Progress progress;
+
+  // what a search stopped by the budget leaves: the root units and the
+  // best assignment of the workers, of best_size variables
+  Partial partial;
+  size_t best_size = 0;
+
+  // assigns the literals that appear with only one polarity in the clauses
+  // not yet satisfied. watched clauses are never deleted, so this is only
+  // done once at the root
+  void find_pureLiterals(Solver &solver) {
+    // bit 0 is set for a positive occurrence, bit 1 for a negative one
+    std::vector<char> polarity(solver.num_vars(), 0);
+    for (int cref : solver.clauses) {
+      Lit *c = solver.lits(cref);
+      if (std::any_of(c, c + solver.size(cref),
+                      [&solver](Lit lit) { return solver.value(lit) > 0; }))
+        continue;
+      for (int k = 0; k < solver.size(cref); k++)
+        if (solver.value(c[k]) == 0)
+          polarity[var_of(c[k])] |= is_neg(c[k]) ? 2 : 1;
+    }
 
-    while (iss >> literal)
-      literals.push_back(literal);
+    for (int var = 0; var < solver.num_vars(); var++) {
+      if (polarity[var] == 1 || polarity[var] == 2)
+        solver.enqueue(make_lit(var, polarity[var] == 2), Solver::NO_REASON);
+    }
+  }
 
-    return literals.size() == 1;
+  // lists the clauses of every variable, for split
+  void index_occurrences(const Solver &solver) {
+    occ_start.assign(solver.num_vars() + 1, 0);
+    for (int cref : solver.clauses)
+      for (int k = 0; k < solver.size(cref); k++)
+        occ_start[var_of(solver.arena[cref + Solver::HEADER + k]) + 1]++;
+    for (int var = 0; var < solver.num_vars(); var++)
+      occ_start[var + 1] += occ_start[var];
+    occ.resize(occ_start.back());
+    std::vector<int> fill(occ_start.begin(), occ_start.end() - 1);
+    for (size_t index = 0; index < solver.clauses.size(); index++) {
+      int cref = solver.clauses[index];
+      for (int k = 0; k < solver.size(cref); k++)
+        occ[fill[var_of(solver.arena[cref + Solver::HEADER + k])]++] = index;
+    }
   }
 
-  // removes the negation of a literal in a unit clause from all clauses
-  void removeUnitfromClauses(std::vector<std::string> &cnf,
-                             const std::string &unit) {
-    for (auto &clause : cnf) {
-      std::istringstream iss(clause);
-      std::vector<std::string> words;
-      std::string word;
-
-      while (iss >> word) {
-        if (word != unit) {
-          words.push_back(word);
+  // splits the unassigned variables of vars that occur in a clause not yet
+  // satisfied into connected components, joining the variables of every such
+  // clause with union-find. vars must be sorted and closed under those
+  // clauses, as the formula or a component of it is. work.order gets the
+  // variables component after component, each sorted, and work.starts the
+  // index where each begins plus the end
+  void split(const Solver &solver, const std::vector<int> &vars,
+             Workspace &work) {
+    std::vector<int> &parent = work.parent;
+    auto find = [&parent](int var) {
+      while (parent[var] != var)
+        var = parent[var] = parent[parent[var]];
+      return var;
+    };
+    for (int var : vars)
+      parent[var] = -1;
+
+    work.stamp++;
+    for (int var : vars) {
+      if (solver.assign[var] != 0)
+        continue;
+      for (int k = occ_start[var]; k < occ_start[var + 1]; k++) {
+        int index = occ[k];
+        if (work.visited[index] == work.stamp)
+          continue;
+        work.visited[index] = work.stamp;
+        int cref = solver.clauses[index];
+        const Lit *c = solver.arena.data() + cref + Solver::HEADER;
+        int n = solver.size(cref);
+        if (std::any_of(c, c + n,
+                        [&solver](Lit lit) { return solver.value(lit) > 0; }))
+          continue;
+        int root = -1;
+        for (int i = 0; i < n; i++) {
+          int other = var_of(c[i]);
+          if (solver.assign[other] != 0)
+            continue;
+          if (parent[other] < 0)
+            parent[other] = other;
+          int r = find(other);
+          if (root < 0)
+            root = r;
+          else if (r != root)
+            parent[r] = root;
         }
       }
+    }
 
-      std::ostringstream oss;
-      for (size_t i = 0; i < words.size(); ++i) {
-        if (i > 0) {
-          oss << " ";
+    // number the components in the order of their lowest variable, then
+    // place the variables with a counting sort
+    work.starts.clear();
+    for (int var : vars)
+      if (solver.assign[var] == 0 && parent[var] >= 0)
+        work.label[find(var)] = -1;
+    for (int var : vars) {
+      if (solver.assign[var] == 0 && parent[var] >= 0) {
+        int &label = work.label[find(var)];
+        if (label < 0) {
+          label = work.starts.size();
+          work.starts.push_back(0);
         }
-        oss << words[i];
+        work.starts[label]++;
       }
-
-      clause = oss.str();
     }
+    int total = 0;
+    for (int &start : work.starts) {
+      int count = start;
+      start = total;
+      total += count;
+    }
+    work.starts.push_back(total);
+    work.order.resize(total);
+    for (int var : vars)
+      if (solver.assign[var] == 0 && parent[var] >= 0)
+        work.order[work.starts[work.label[find(var)]]++] = var;
+    for (size_t k = work.starts.size() - 1; k-- > 0;)
+      work.starts[k + 1] = work.starts[k];
+    work.starts[0] = 0;
   }
 
-  // deletes the clausea containing the unit clause
-  void deleteClause(std::vector<std::string> &cnf, const std::string &unit) {
-    cnf.erase(std::remove_if(cnf.begin(), cnf.end(),
-                             [&unit](const std::string &clause) {
-                               std::istringstream iss(clause);
-                               std::string word;
-                               while (iss >> word) {
-                                 if (word == unit) {
-                                   return true;
-                                 }
-                               }
-                               return false;
-                             }),
-              cnf.end());
+  // starts searching a component made of the variables from begin to end,
+  // at the current decision level
+  void open_frame(const Solver &solver, Workspace &work,
+                  std::vector<int>::const_iterator begin,
+                  std::vector<int>::const_iterator end, int next_split) {
+    if (work.depth == work.frames.size())
+      work.frames.emplace_back();
+    Frame &frame = work.frames[work.depth++];
+    frame.level = solver.decision_level();
+    frame.first = work.flipped.size();
+    frame.next_split = next_split;
+    frame.vars.assign(begin, end);
   }
 
-  // finds pure literals in the cnf
-  void find_pureLiterals(std::vector<std::string> cnf,
-                         std::vector<std::string> &pureLiterals) {
-    std::unordered_map<std::string, int> posLiteralCount;
-    std::unordered_map<std::string, int> negLiteralCount;
-
-    for (const auto &clause : cnf) {
-      std::istringstream iss(clause);
-      std::string literal;
-      while (iss >> literal) {
-        if (literal[0] == '~') {
-          negLiteralCount[literal.substr(1)]++;
-        } else {
-          posLiteralCount[literal]++;
-        }
+  // the variable to branch on: the lowest unassigned one of the innermost
+  // component left to search, -1 once they are all assigned. a component
+  // whose variables are all assigned is satisfied, and its decisions are
+  // closed by marking them flipped: whatever fails later does not depend on
+  // them, so backtracking does not try their other branches. a component
+  // is split when the search enters it, when one of its parts is done, and
+  // again 1, 2, 4, 8... decisions into it, so that the levels near its
+  // root, where falling apart saves the most, are looked at often and the
+  // deep ones rarely. the search goes on with the part of the lowest
+  // variable
+  int pick_branch(const Solver &solver, Workspace &work) {
+    while (work.depth > 0) {
+      Frame &top = work.frames[work.depth - 1];
+      auto it = std::find_if(top.vars.begin(), top.vars.end(),
+                             [&solver](int v) { return !solver.assign[v]; });
+      if (it == top.vars.end()) {
+        std::fill(work.flipped.begin() + top.first, work.flipped.end(), true);
+        work.depth--;
+        if (work.depth > 0)
+          work.frames[work.depth - 1].next_split = solver.decision_level();
+        continue;
       }
+      if (solver.decision_level() < top.next_split)
+        return *it;
+
+      split(solver, top.vars, work);
+      int depth = solver.decision_level() - top.level;
+      top.next_split = solver.decision_level() + std::max(1, depth);
+      // one part, or none when no open clause is left and the rest can
+      // take any value
+      if (work.starts.size() <= 2)
+        return *it;
+      open_frame(solver, work, work.order.begin(),
+                 work.order.begin() + work.starts[1],
+                 solver.decision_level() + 1);
+      return work.order[0];
     }
+    return -1;
+  }
 
-    for (const auto &literal : posLiteralCount) {
-      if (literal.second > 0 && negLiteralCount[literal.first] == 0) {
-        if (std::find(pureLiterals.begin(), pureLiterals.end(),
-                      literal.first) == pureLiterals.end())
-          pureLiterals.push_back(literal.first);
-      }
+  // drops the components split off above the current decision level, the
+  // outermost one is the subproblem's own. the one left splits again at
+  // the level they were split at, where the other branch is taken next
+  void unwind(const Solver &solver, Workspace &work) {
+    while (work.depth > 1 &&
+           work.frames[work.depth - 1].level > solver.decision_level()) {
+      work.depth--;
+      int &next_split = work.frames[work.depth - 1].next_split;
+      next_split = std::min(next_split, work.frames[work.depth].level);
     }
+  }
 
-    for (const auto &literal : negLiteralCount) {
-      if (literal.second > 0 && posLiteralCount[literal.first] == 0) {
-        if (std::find(pureLiterals.begin(), pureLiterals.end(),
-                      "~" + literal.first) == pureLiterals.end())
-          pureLiterals.push_back("~" + literal.first);
-      }
+  // records the values of a component if no other worker solved it first,
+  // the formula is solved once all of its components are
+  bool found(const Solver &solver, int component) {
+    if (solved[component].exchange(true))
+      return false;
+    {
+      // to prevent simultaneous writing to the global variables
+      std::lock_guard<std::mutex> lock(mtx);
+      for (int var : components[component])
+        if (solver.assign[var] != 0)
+          assign[var] = solver.assign[var];
+    }
+    if (++n_solved == (int)components.size()) {
+      solution_found = true;
+      stop.store(true, std::memory_order_release);
     }
+    return true;
   }
 
-  bool solve(std::vector<std::string> cnf, std::set<std::string> literals,
-             std::set<std::string> local_assign_t,
-             std::set<std::string> local_assign_f, int depth = 0) {
+  void push(int id, Job job) {
+    pending++;
+    open[job.component]++;
+    {
+      std::lock_guard<std::mutex> lock(queues[id].mtx);
+      queues[id].jobs.push_back(std::move(job));
+    }
+    queued++;
+    wake(false);
+  }
 
-    // if a solution has been found by another thread, return false
-    if (solution_found.load(std::memory_order_acquire))
-      return false;
+  // a subproblem is done. once every subproblem of a component is done
+  // without a solution, the formula is unsatisfiable. the search only ever
+  // stops in a busy worker, which then gets here, so the idle workers are
+  // woken to leave once it stops or nothing is pending
+  void finish(int component) {
+    if (--open[component] == 0 && !solved[component])
+      stop.store(true, std::memory_order_release);
+    if (--pending == 0 || stop.load(std::memory_order_acquire))
+      wake(true);
+  }
 
-    // remove duplicates
-    std::sort(cnf.begin(), cnf.end());
-    cnf.erase(std::unique(cnf.begin(), cnf.end()), cnf.end());
-
-    // checks for unit clauses
-    std::vector<std::string> units;
-    std::copy_if(
-        cnf.begin(), cnf.end(), std::back_inserter(units),
-        [this](const std::string &clause) { return is_unit_clause(clause); });
-
-    // checks for pure literals
-    find_pureLiterals(cnf, units);
-
-    // assign the unit clauses and pure literals
-    if (!units.empty()) {
-      for (const auto &unit : units) {
-        // removes clauses containing the unit clause,
-        // and removes the negation of the unit clause from all clauses
-        if (unit[0] == '~') {
-          local_assign_f.insert(unit.substr(1));
-          deleteClause(cnf, unit);
-          removeUnitfromClauses(cnf, unit.substr(1));
-        } else {
-          local_assign_t.insert(unit);
-          deleteClause(cnf, unit);
-          removeUnitfromClauses(cnf, '~' + unit);
-        }
+  // taking the lock orders the change before the check of an idle worker
+  // about to wait, so that none misses it
+  void wake(bool all) {
+    { std::lock_guard<std::mutex> lock(idle_mtx); }
+    if (all)
+      ready.notify_all();
+    else
+      ready.notify_one();
+  }
+
+  // takes a subproblem from the worker's own queue, or steals one from
+  // another worker
+  bool take(int id, Job &job) {
+    int n = queues.size();
+    for (int k = 0; k < n; k++) {
+      WorkQueue &queue = queues[(id + k) % n];
+      std::lock_guard<std::mutex> lock(queue.mtx);
+      if (queue.jobs.empty())
+        continue;
+      if (k == 0) {
+        job = std::move(queue.jobs.back());
+        queue.jobs.pop_back();
+      } else {
+        job = std::move(queue.jobs.front());
+        queue.jobs.pop_front();
       }
+      queued--;
+      return true;
     }
+    return false;
+  }
 
-    if (cnf.empty()) {
-      // if other threads have not found a solution yet and this thread has
-      // write the assignment to the global variables, and change the flag
-      if (!solution_found.exchange(true, std::memory_order_release)) {
-        // to prevent simultaneous writing to the global variables
-        std::lock_guard<std::mutex> lock(mtx);
-        assign_t = local_assign_t;
-        assign_f = local_assign_f;
-        return true;
-      }
-      return false;
+  // gives away the untried branch of the oldest open decision, the one with
+  // the largest subtree left, as a subproblem other workers can steal
+  void donate(Solver &solver, Workspace &work, int root, int id,
+              int component) {
+    std::vector<char> &flipped = work.flipped;
+    size_t i = 0;
+    while (i < flipped.size() && flipped[i])
+      i++;
+    if (i == flipped.size())
+      return;
+
+    int level = root + i;
+    Job job;
+    job.component = component;
+    if (!work.spare.empty()) {
+      job.cube = std::move(work.spare.back());
+      work.spare.pop_back();
+      job.cube.clear();
     }
+    for (int k = 0; k < level; k++)
+      job.cube.push_back(solver.trail[solver.trail_lim[k]]);
+    job.cube.push_back(negate(solver.trail[solver.trail_lim[level]]));
+    flipped[i] = true;
+    push(id, std::move(job));
+  }
 
-    // if there are empty clauses, return false
-    if (std::any_of(cnf.begin(), cnf.end(),
-                    [](const std::string &clause) { return clause.empty(); })) {
-      return false;
+  // replays the decisions of a subproblem from the root, returns false if
+  // they conflict
+  bool replay(Solver &solver, const Cube &cube) {
+    solver.backtrack(0);
+    for (Lit lit : cube) {
+      if (solver.value(lit) < 0)
+        return false;
+      if (solver.value(lit) > 0)
+        continue;
+      solver.decide(lit);
+      if (solver.propagate() != Solver::NO_REASON)
+        return false;
+    }
+    return true;
+  }
+
+  // depth first search with chronological backtracking of a component,
+  // below the decision level the solver is at when called. while some
+  // workers are idle, the oldest open branch is handed out to them
+  bool search(Solver &solver, int id, int component, Workspace &work,
+              Stats &counters, Stats &flushed) {
+    int root = solver.decision_level();
+    std::vector<char> &flipped = work.flipped;
+    flipped.clear();
+    // split at once, the decisions of a stolen subproblem may have broken
+    // the component up
+    work.depth = 0;
+    open_frame(solver, work, components[component].begin(),
+               components[component].end(), root);
+
+    while (true) {
+      if (budget.limited() && budget.spent(counters, work.charged))
+        stop.store(true, std::memory_order_release);
+      // if a solution has been found, the component solved by another
+      // thread, the formula found unsatisfiable or the budget spent, return
+      // false
+      if (stop.load(std::memory_order_acquire) ||
+          solved[component].load(std::memory_order_relaxed))
+        return false;
+
+      int conflict;
+      {
+        PhaseTimer timer(counters.propagate);
+        conflict = solver.propagate();
+      }
+      if (conflict != Solver::NO_REASON) {
+        counters.conflicts++;
+        if (budget.limited() && solver.trail.size() > work.best_size) {
+          work.best_size = solver.trail.size();
+          work.best = solver.assign;
+        }
+        // undo the decisions whose both branches failed
+        while (!flipped.empty() && flipped.back()) {
+          flipped.pop_back();
+          solver.backtrack(solver.decision_level() - 1);
+        }
+        if (flipped.empty())
+          return false;
+
+        // try the other branch of the latest decision
+        Lit literal = solver.trail[solver.trail_lim.back()];
+        solver.backtrack(solver.decision_level() - 1);
+        unwind(solver, work);
+        solver.decide(negate(literal));
+        flipped.back() = true;
+        continue;
+      }
+
+      int var = pick_branch(solver, work);
+      if (var < 0)
+        return found(solver, component);
+
+      if (pending.load(std::memory_order_relaxed) < (int)queues.size())
+        donate(solver, work, root, id, component);
+
+      // try the value the variable last had first, true if it never had one
+      solver.decide(make_lit(var, solver.phase[var] < 0));
+      if (++counters.decisions % Progress::FLUSH_INTERVAL == 0)
+        flush(solver, counters, flushed);
+      flipped.push_back(false);
     }
+  }
 
-    literals.clear();
-    for (const auto &clause : cnf) {
-      std::istringstream iss(clause);
-      std::string literal;
+  // adds what a worker counted since its last flush to the progress line,
+  // flushed holds the counts already added
+  void flush(const Solver &solver, const Stats &counters, Stats &flushed) {
+    progress.add(counters.decisions - flushed.decisions,
+                 solver.n_prop - flushed.propagations,
+                 counters.conflicts - flushed.conflicts);
+    flushed.decisions = counters.decisions;
+    flushed.propagations = solver.n_prop;
+    flushed.conflicts = counters.conflicts;
+  }
 
-      while (iss >> literal) {
-        if (literal[0] == '~')
-          literals.insert(literal.substr(1));
-        else
-          literals.insert(literal);
+  // runs subproblems until the formula is solved, found unsatisfiable, or
+  // none are left
+  void worker(int id, Solver solver) {
+    Stats counters;
+    long long root_prop = solver.n_prop;
+    Stats flushed;
+    flushed.propagations = root_prop;
+    Workspace work;
+    work.parent.resize(solver.num_vars());
+    work.label.resize(solver.num_vars());
+    work.visited.assign(solver.clauses.size(), 0);
+    Job job;
+    while (!stop.load(std::memory_order_acquire)) {
+      if (!take(id, job)) {
+        std::unique_lock<std::mutex> lock(idle_mtx);
+        ready.wait(lock, [this]() {
+          return queued > 0 || pending == 0 || stop.load();
+        });
+        if (pending == 0)
+          break;
+        continue;
       }
+
+      if (!solved[job.component] && replay(solver, job.cube))
+        search(solver, id, job.component, work, counters, flushed);
+      finish(job.component);
+      if (work.spare.size() < Workspace::MAX_SPARE)
+        work.spare.push_back(std::move(job.cube));
     }
 
-    if (!literals.empty()) {
-      std::string literal = *literals.begin();
-      std::vector<std::string> new_cnf_t = cnf;
-      std::vector<std::string> new_cnf_f = cnf;
-      new_cnf_t.push_back(literal);
-      new_cnf_f.push_back("~" + literal);
-
-      std::vector<std::future<bool>> futures;
-
-      if (depth < 2) {
-        // create two threads to explore the two branches
-
-        // one thread with the literal assigned to true
-        auto local_assign_t_true = local_assign_t;
-        auto local_assign_f_true = local_assign_f;
-        local_assign_t_true.insert(literal);
-        // one thread with the literal assigned to false
-        auto local_assign_t_false = local_assign_t;
-        auto local_assign_f_false = local_assign_f;
-        local_assign_f_false.insert(literal);
-
-        // launch the threads
-        // emplace_back is used to avoid copying the futures, to save memory
-        futures.emplace_back(std::async(
-            std::launch::async, [this, new_cnf_t, literals, local_assign_t_true,
-                                 local_assign_f_true, depth]() {
-              return solve(new_cnf_t, literals, local_assign_t_true,
-                           local_assign_f_true, depth + 1);
-            }));
-        futures.emplace_back(
-            std::async(std::launch::async,
-                       [this, new_cnf_f, literals, local_assign_t_false,
-                        local_assign_f_false, depth]() {
-                         return solve(new_cnf_f, literals, local_assign_t_false,
-                                      local_assign_f_false, depth + 1);
-                       }));
-
-        bool result = false;
-        // if one of the threads found a solution, return true
-        for (auto &f : futures) {
-          if (f.get())
-            result = true;
+    flush(solver, counters, flushed);
+    counters.propagations = solver.n_prop - root_prop;
+    std::lock_guard<std::mutex> lock(mtx);
+    stats += counters;
+    if (work.best_size > best_size) {
+      best_size = work.best_size;
+      partial.assign = std::move(work.best);
+    }
+  }
+
+  // lists up to limit models, all of them for 0, without blocking clauses:
+  // a model is handled like a conflict, and the search goes on with the
+  // other branch of the latest decision. the projected variables are
+  // decided first, and with a model the decisions on the others are closed,
+  // since an assignment of the projected ones is listed once. returns the
+  // number of models
+  long long list_models(
+      Solver &solver, long long limit, const std::vector<char> &projected,
+      const std::function<void(const std::vector<signed char> &)> &report) {
+    std::vector<char> flipped;
+    long long found = 0;
+    while (true) {
+      if (solver.propagate() == Solver::NO_REASON) {
+        int var = -1;
+        for (int other = 0; other < solver.num_vars(); other++) {
+          if (solver.assign[other] == 0 &&
+              (var < 0 || (projected[other] && !projected[var]))) {
+            var = other;
+            if (projected[var])
+              break;
+          }
+        }
+        if (var >= 0) {
+          stats.decisions++;
+          solver.decide(make_lit(var, false));
+          flipped.push_back(false);
+          continue;
         }
 
-        return result;
+        found++;
+        report(solver.assign);
+        if (limit > 0 && found >= limit)
+          return found;
+        for (size_t k = 0; k < flipped.size(); k++)
+          if (!projected[var_of(solver.trail[solver.trail_lim[k]])])
+            flipped[k] = true;
       } else {
-        auto local_assign_t_true = local_assign_t;
-        auto local_assign_f_true = local_assign_f;
-        local_assign_t_true.insert(literal);
-
-        auto local_assign_t_false = local_assign_t;
-        auto local_assign_f_false = local_assign_f;
-        local_assign_f_false.insert(literal);
-
-        return solve(new_cnf_t, literals, local_assign_t_true,
-                     local_assign_f_true, depth + 1) ||
-               solve(new_cnf_f, literals, local_assign_t_false,
-                     local_assign_f_false, depth + 1);
+        stats.conflicts++;
+      }
+
+      // undo the decisions whose both branches are done
+      while (!flipped.empty() && flipped.back()) {
+        flipped.pop_back();
+        solver.backtrack(solver.decision_level() - 1);
       }
+      if (flipped.empty())
+        return found;
+      Lit literal = solver.trail[solver.trail_lim.back()];
+      solver.backtrack(solver.decision_level() - 1);
+      solver.decide(negate(literal));
+      flipped.back() = true;
     }
+  }
 
-    return false;
+  // the projection of a list of names, every variable being projected
+  // when the list is empty. false if a name is not in the formula
+  bool project(const std::string &projected, std::vector<int> &projection,
+               std::vector<char> &mask) {
+    if (!cnf.lookup(projected, projection))
+      return false;
+    mask.assign(cnf.num_vars(), projection.empty());
+    for (int var : projection)
+      mask[var] = 1;
+    return true;
   }
 
 public:
-  void dpll(const std::string &filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-      std::cerr << "Error opening file " << filename << std::endl;
-      return;
+  // limits on the search, none by default. a search stopped by them
+  // answers "s UNKNOWN"
+  Budget budget;
+
+  // a progress line is printed every second, and with print_stats the time
+  // of every phase at the end. the propagation time is summed over the
+  // workers, the search time is the wall time of the parallel search.
+  // what is left of the formula after the root propagation is split into
+  // variable-disjoint components, searched as separate subproblems whose
+  // models are merged. once the budget is spent, the answer is
+  // "s UNKNOWN" and, given a dump file, the units of the root propagation
+  // and the fullest assignment the workers reached are written to it, for
+  // a later run to resume from: the units are added to its formula and the
+  // assignment gives the values it tries first. returns the exit status
+  int dpll(const std::string &filename, bool preprocess = true,
+           bool print_stats = false, const std::string &dump_file = "",
+           const std::string &resume_file = "") {
+    {
+      PhaseTimer timer(stats.parse);
+      if (!cnf.load(filename))
+        return 1;
+    }
+    Partial resumed;
+    if (!resume_file.empty()) {
+      if (!read_partial(resume_file, cnf, resumed))
+        return 1;
+      for (Lit lit : resumed.units)
+        cnf.add_clause({lit});
     }
 
-    std::vector<std::string> cnf;
-    std::set<std::string> literals;
-    std::string line;
+    std::cout << "Solving " << filename << "..." << std::endl;
 
-    while (std::getline(file, line)) {
-      cnf.push_back(line);
-      std::istringstream iss(line);
-      std::string literal;
+    Preprocessor preprocessor;
+    bool consistent = true;
+    if (preprocess) {
+      PhaseTimer timer(stats.preprocess);
+      consistent = preprocessor.run(cnf);
+      std::cout << "Preprocessing: " << preprocessor.n_fixed << " fixed, "
+                << preprocessor.n_eliminated << " eliminated, "
+                << cnf.num_clauses() << " clauses left" << std::endl;
+    }
 
-      while (iss >> literal) {
-        if (literal[0] == '~')
-          literals.insert(literal.substr(1));
-        else
-          literals.insert(literal);
+    Solver solver;
+    if (consistent && solver.load(cnf) &&
+        solver.propagate() == Solver::NO_REASON) {
+      // the pure literals do not follow from the formula, they are not
+      // units to resume from
+      partial.units = solver.trail;
+      for (size_t var = 0; var < resumed.assign.size(); var++)
+        if (resumed.assign[var] != 0)
+          solver.phase[var] = resumed.assign[var];
+      find_pureLiterals(solver);
+      stats.propagations = solver.n_prop;
+
+      // variables no clause constrains any more keep the value true
+      assign = solver.assign;
+      for (signed char &value : assign)
+        if (value == 0)
+          value = 1;
+
+      index_occurrences(solver);
+      Workspace root;
+      std::vector<int> all(solver.num_vars());
+      std::iota(all.begin(), all.end(), 0);
+      root.parent.resize(solver.num_vars());
+      root.label.resize(solver.num_vars());
+      root.visited.assign(solver.clauses.size(), 0);
+      split(solver, all, root);
+      for (size_t k = 0; k + 1 < root.starts.size(); k++)
+        components.emplace_back(root.order.begin() + root.starts[k],
+                                root.order.begin() + root.starts[k + 1]);
+      open.resize(components.size());
+      solved.resize(components.size());
+      if (components.size() > 1)
+        std::cout << "Components: " << components.size() << std::endl;
+      if (components.empty())
+        solution_found = true;
+
+      // one worker per core, each with its own copy of the solver, starting
+      // from the components spread over their queues
+      int n_workers = std::max(1u, std::thread::hardware_concurrency());
+      for (int id = 0; id < n_workers; id++)
+        queues.emplace_back();
+      for (size_t k = 0; k < components.size(); k++) {
+        Job job;
+        job.component = k;
+        push(k % n_workers, std::move(job));
       }
-    }
 
-    std::cout << "Solving " << filename << "..." << std::endl;
+      PhaseTimer timer(stats.search);
+      progress.start();
+      std::vector<std::thread> workers;
+      for (int id = 0; id < n_workers; id++)
+        workers.emplace_back(&DPLL::worker, this, id, solver);
+      for (auto &w : workers)
+        w.join();
+      progress.stop();
+    }
 
-    if (solve(cnf, literals, std::set<std::string>(),
-              std::set<std::string>())) {
-      std::cout << "\nSATISFIABLE" << std::endl;
-      std::cout << "assignment written to output_dpll.txt" << std::endl;
-      std::ofstream output("output_dpll.txt");
-      {
-        std::lock_guard<std::mutex> lock(mtx);
-        for (const auto &literal : assign_t)
-          output << literal << std::endl;
-        for (const auto &literal : assign_f)
-          output << "~" << literal << std::endl;
-      }
-      output.close();
+    // a component proved unsatisfiable as the budget ran out is reported
+    // as unknown
+    bool unknown = !solution_found && budget.exhausted();
+    if (solution_found) {
+      preprocessor.extend(assign);
+      write_model("output_dpll.txt", cnf, assign);
+    }
+    std::cout << std::endl;
+    if (unknown) {
+      std::cout << "s UNKNOWN" << std::endl;
+      std::cout << "Budget exhausted: " << budget.describe() << std::endl;
+      if (!dump_file.empty() && write_partial(dump_file, cnf, partial))
+        std::cout << "Partial assignment written to " << dump_file
+                  << std::endl;
     } else {
-      std::cout << "\nUNSATISFIABLE" << std::endl;
+      write_solution(std::cout, solution_found, cnf, assign);
+    }
+    if (solution_found)
+      std::cout << "assignment written to output_dpll.txt" << std::endl;
+    stats.print_counters(std::cout);
+    if (print_stats)
+      stats.print(std::cout);
+    std::cout << std::endl;
+    return unknown ? EXIT_UNKNOWN : 0;
+  }
+
+  // lists up to limit models, all of them for 0, as "v" lines, one after
+  // the other by a single search. with a list of projected variables, only
+  // their values are listed, and each assignment of them once. neither the
+  // preprocessor nor the pure literals are used, since they lose models
+  void enumerate(const std::string &filename, long long limit,
+                 const std::string &projected, bool print_stats = false) {
+    {
+      PhaseTimer timer(stats.parse);
+      if (!cnf.load(filename))
+        return;
+    }
+    std::vector<int> projection;
+    std::vector<char> mask;
+    if (!project(projected, projection, mask))
+      return;
+
+    long long found = 0;
+    BufferedWriter writer(std::cout);
+    Solver solver;
+    if (solver.load(cnf)) {
+      PhaseTimer timer(stats.search);
+      found = list_models(solver, limit, mask,
+                          [&](const std::vector<signed char> &model) {
+                            write_values(writer, cnf, model, projection);
+                          });
+    }
+    stats.propagations = solver.n_prop;
+
+    writer.write(found > 0 ? "s SATISFIABLE\n" : "s UNSATISFIABLE\n");
+    writer.write("Models: " + std::to_string(found));
+    writer.write(limit > 0 && found == limit ? " (limit reached)\n" : "\n");
+    writer.flush();
+    stats.print_counters(std::cout);
+    if (print_stats)
+      stats.print(std::cout);
+    std::cout << std::endl;
+  }
+
+  // counts the models, or with a list of projected variables the
+  // assignments of them that extend to a model, see ModelCounter
+  void count(const std::string &filename, const std::string &projected,
+             bool print_stats = false) {
+    {
+      PhaseTimer timer(stats.parse);
+      if (!cnf.load(filename))
+        return;
+    }
+    std::vector<int> projection;
+    std::vector<char> mask;
+    if (!project(projected, projection, mask))
+      return;
+
+    ModelCounter counter;
+    Count models;
+    {
+      PhaseTimer timer(stats.search);
+      models = counter.count(cnf, projection);
     }
+    stats.decisions = counter.decisions;
+
+    std::cout << (models.is_zero() ? "s UNSATISFIABLE" : "s SATISFIABLE")
+              << std::endl;
+    std::cout << "Models: " << models.str() << std::endl;
+    std::cout << "Cache hits: " << counter.cache_hits << std::endl;
+    stats.print_counters(std::cout);
+    if (print_stats)
+      stats.print(std::cout);
     std::cout << std::endl;
   }
 };
 
 int main(int argc, char *argv[]) {
-  if (argc != 2) {
-    std::cerr << "Usage: " << argv[0] << " <input_file>" << std::endl;
+  // --no-preprocess searches the formula as it is read
+  // --stats prints the time of every phase and the rates at the end
+  // --enumerate N lists up to N models, all of them for 0
+  // --count counts the models
+  // --project LIST lists or counts only the assignments of the variables of
+  //   LIST, names separated by commas
+  // --time-limit S, --conflict-limit N, --decision-limit N and
+  //   --memory-limit MB stop the search for a model with "s UNKNOWN" and
+  //   the exit status EXIT_UNKNOWN once one of them is reached
+  // --dump FILE writes what a search stopped that way leaves to FILE
+  // --resume FILE starts from what a stopped search left in FILE
+  bool preprocess = true, print_stats = false, count = false;
+  long long limit = -1;
+  std::string projected, dump_file, resume_file;
+  DPLL solver;
+  int arg = 1;
+  for (; arg < argc - 1; arg++) {
+    std::string option = argv[arg];
+    std::string value = (arg + 2 < argc) ? argv[arg + 1] : "";
+    if (option == "--no-preprocess") {
+      preprocess = false;
+    } else if (option == "--stats") {
+      print_stats = true;
+    } else if (option == "--count") {
+      count = true;
+    } else if (option == "--enumerate" && std::atoll(value.c_str()) >= 0 &&
+               !value.empty()) {
+      limit = std::atoll(value.c_str());
+      arg++;
+    } else if (option == "--project" && !value.empty()) {
+      projected = value;
+      arg++;
+    } else if (option == "--time-limit" && std::atof(value.c_str()) > 0) {
+      solver.budget.seconds = std::atof(value.c_str());
+      arg++;
+    } else if (option == "--conflict-limit" &&
+               std::atoll(value.c_str()) > 0) {
+      solver.budget.conflicts = std::atoll(value.c_str());
+      arg++;
+    } else if (option == "--decision-limit" &&
+               std::atoll(value.c_str()) > 0) {
+      solver.budget.decisions = std::atoll(value.c_str());
+      arg++;
+    } else if (option == "--memory-limit" && std::atoll(value.c_str()) > 0) {
+      solver.budget.megabytes = std::atoll(value.c_str());
+      arg++;
+    } else if (option == "--dump" && !value.empty()) {
+      dump_file = value;
+      arg++;
+    } else if (option == "--resume" && !value.empty()) {
+      resume_file = value;
+      arg++;
+    } else {
+      break;
+    }
+  }
+  if (arg != argc - 1) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--no-preprocess] [--stats]"
+              << " [--enumerate N | --count] [--project LIST]"
+              << " [--time-limit S] [--conflict-limit N]"
+              << " [--decision-limit N] [--memory-limit MB] [--dump FILE]"
+              << " [--resume FILE] <input_file>" << std::endl;
     return 1;
   }
 
-  DPLL solver;
-  solver.dpll(argv[1]);
-
-  return 0;
+  if (count) {
+    solver.count(argv[arg], projected, print_stats);
+    return 0;
+  }
+  if (limit >= 0) {
+    solver.enumerate(argv[arg], limit, projected, print_stats);
+    return 0;
+  }
+  return solver.dpll(argv[arg], preprocess, print_stats, dump_file,
+                     resume_file);
 }
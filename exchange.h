@@ -0,0 +1,90 @@
+#ifndef EXCHANGE_H
+#define EXCHANGE_H
+
+#include "cnf.h"
+
+// lock-free bounded buffer through which parallel solvers share short
+// learned clauses. publishing claims the next slot of a ring, overwriting
+// the oldest clause, and each reader keeps its own cursor. every slot is a
+// seqlock: its stamp is odd while a writer fills it and 2 * n + 2 once it
+// holds the n-th published clause, so readers drop clauses that are
+// overwritten or still being written instead of waiting.
+class ClauseExchange {
+public:
+  static constexpr int CAPACITY = 4096;
+  static constexpr int MAX_SIZE = 8;
+
+private:
+  struct Slot {
+    std::atomic<uint64_t> stamp{0};
+    std::atomic<int> source{0}, size{0}, lbd{0};
+    std::atomic<Lit> lits[MAX_SIZE];
+  };
+
+  std::vector<Slot> slots = std::vector<Slot>(CAPACITY);
+  std::atomic<uint64_t> head{0};
+
+public:
+  // true if clauses were published after the cursor
+  bool available(uint64_t cursor) const {
+    return head.load(std::memory_order_acquire) > cursor;
+  }
+
+  // shares a clause of at most MAX_SIZE literals. if a slow writer still
+  // holds the slot the clause is dropped
+  void publish(int source, const std::vector<Lit> &clause, int lbd) {
+    if (clause.size() > (size_t)MAX_SIZE)
+      return;
+    uint64_t n = head.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = slots[n % CAPACITY];
+
+    // the odd stamp claims the slot before any write to it, and the fence
+    // keeps all the writes before the even stamp that closes it
+    uint64_t stamp = slot.stamp.load(std::memory_order_relaxed);
+    if ((stamp & 1) || !slot.stamp.compare_exchange_strong(
+                           stamp, 2 * n + 1, std::memory_order_acq_rel))
+      return;
+
+    slot.source.store(source, std::memory_order_relaxed);
+    slot.size.store(clause.size(), std::memory_order_relaxed);
+    slot.lbd.store(lbd, std::memory_order_relaxed);
+    for (size_t k = 0; k < clause.size(); k++)
+      slot.lits[k].store(clause[k], std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.stamp.store(2 * n + 2, std::memory_order_release);
+  }
+
+  // calls receive(clause, lbd) for every clause published by another
+  // source since the cursor, and moves the cursor past them. the clauses are
+  // copied into the reader's own buffer
+  template <typename Receive>
+  void collect(int reader, uint64_t &cursor, std::vector<Lit> &clause,
+               Receive receive) {
+    uint64_t end = head.load(std::memory_order_acquire);
+    if (end - cursor > (uint64_t)CAPACITY)
+      cursor = end - CAPACITY;
+
+    for (; cursor < end; cursor++) {
+      Slot &slot = slots[cursor % CAPACITY];
+      uint64_t stamp = slot.stamp.load(std::memory_order_acquire);
+      if (stamp != 2 * cursor + 2)
+        continue;
+
+      int source = slot.source.load(std::memory_order_relaxed);
+      int size = slot.size.load(std::memory_order_relaxed);
+      int lbd = slot.lbd.load(std::memory_order_relaxed);
+      clause.resize(size);
+      for (int k = 0; k < size; k++)
+        clause[k] = slot.lits[k].load(std::memory_order_relaxed);
+
+      // the copy is only valid if no writer claimed the slot meanwhile
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.stamp.load(std::memory_order_relaxed) != stamp)
+        continue;
+      if (source != reader)
+        receive(clause, lbd);
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <bits/stdc++.h>
+
+// binary max-heap of variables ordered by their activity. pos[var] is the
+// index of the variable in the heap, or -1 if it is not in it
+class VarHeap {
+private:
+  const std::vector<double> *activity = nullptr;
+  std::vector<int> heap;
+  std::vector<int> pos;
+
+  bool before(int a, int b) const { return (*activity)[a] > (*activity)[b]; }
+
+  void sift_up(int i) {
+    int var = heap[i];
+    while (i > 0) {
+      int parent = (i - 1) / 2;
+      if (!before(var, heap[parent]))
+        break;
+      heap[i] = heap[parent];
+      pos[heap[i]] = i;
+      i = parent;
+    }
+    heap[i] = var;
+    pos[var] = i;
+  }
+
+  void sift_down(int i) {
+    int var = heap[i];
+    int n = heap.size();
+    while (2 * i + 1 < n) {
+      int child = 2 * i + 1;
+      if (child + 1 < n && before(heap[child + 1], heap[child]))
+        child++;
+      if (!before(heap[child], var))
+        break;
+      heap[i] = heap[child];
+      pos[heap[i]] = i;
+      i = child;
+    }
+    heap[i] = var;
+    pos[var] = i;
+  }
+
+public:
+  // builds the heap over every variable of the activity vector
+  void init(const std::vector<double> *act) {
+    activity = act;
+    int n = act->size();
+    heap.resize(n);
+    pos.resize(n);
+    std::iota(heap.begin(), heap.end(), 0);
+    for (int i = n / 2 - 1; i >= 0; i--)
+      sift_down(i);
+    for (int i = 0; i < n; i++)
+      pos[heap[i]] = i;
+  }
+
+  // adds the variables up to the new size of the activity vector
+  void grow(int n) {
+    int old = pos.size();
+    pos.resize(n, -1);
+    for (int var = old; var < n; var++)
+      insert(var);
+  }
+
+  bool empty() const { return heap.empty(); }
+  bool contains(int var) const { return pos[var] >= 0; }
+
+  void insert(int var) {
+    if (contains(var))
+      return;
+    pos[var] = heap.size();
+    heap.push_back(var);
+    sift_up(pos[var]);
+  }
+
+  // restores the order after the activity of a variable went up
+  void increased(int var) {
+    if (contains(var))
+      sift_up(pos[var]);
+  }
+
+  // removes and returns the most active variable
+  int pop() {
+    int top = heap[0];
+    pos[top] = -1;
+    int last = heap.back();
+    heap.pop_back();
+    if (!heap.empty()) {
+      heap[0] = last;
+      pos[last] = 0;
+      sift_down(0);
+    }
+    return top;
+  }
+};
+
+#endif
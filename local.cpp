@@ -0,0 +1,110 @@
+#include "local.h"
+#include "output.h"
+#include "preprocess.h"
+#include "stats.h"
+
+class DPLL {
+private:
+  CNF cnf;
+
+public:
+  // searches for a model with probSAT. the formula is preprocessed first,
+  // and the eliminated variables are set back from the reconstruction
+  // stack. without a model within the budget the answer is UNKNOWN
+  void dpll(const std::string &filename, unsigned seed, long long max_flips,
+            long long budget, bool preprocess = true,
+            bool print_stats = false) {
+    Stats stats;
+    {
+      PhaseTimer timer(stats.parse);
+      if (!cnf.load(filename))
+        return;
+    }
+
+    Preprocessor preprocessor;
+    bool consistent = true;
+    if (preprocess) {
+      PhaseTimer timer(stats.preprocess);
+      consistent = preprocessor.run(cnf);
+      std::clog << "Preprocessing: " << preprocessor.n_fixed << " fixed, "
+                << preprocessor.n_eliminated << " eliminated, "
+                << cnf.num_clauses() << " clauses left" << std::endl;
+    }
+
+    LocalSearch search;
+    bool found = false;
+    if (consistent) {
+      PhaseTimer timer(stats.search);
+      search.load(cnf, seed);
+      consistent = !search.contradiction;
+      found = search.solve(max_flips, budget);
+    }
+
+    std::cout << std::endl;
+    if (found) {
+      std::vector<signed char> model = search.assign;
+      preprocessor.extend(model);
+      write_model("output_dpll.txt", cnf, model);
+      write_solution(std::cout, true, cnf, model);
+      std::cout << "Solution written output_dpll.txt" << std::endl;
+    } else if (!consistent) {
+      write_solution(std::cout, false, cnf, {});
+    } else {
+      std::cout << "s UNKNOWN" << std::endl;
+      std::cout << "Fewest unsatisfied clauses: " << search.best_unsat
+                << std::endl;
+    }
+    std::cout << "Flips: " << search.n_flips << std::endl;
+    if (print_stats)
+      std::cout << "Flips/s: "
+                << (long long)(stats.search > 0 ? search.n_flips / stats.search
+                                                : 0)
+                << std::endl;
+    std::cout << std::endl;
+  }
+};
+
+int main(int argc, char *argv[]) {
+  // --seed N seeds the random choices
+  // --flips N flips of a try before it restarts from a random assignment
+  // --budget N flips in total before giving up
+  // --no-preprocess searches the formula as it is read
+  // --stats prints the flip rate
+  unsigned seed = 0;
+  long long max_flips = 100000000, budget = 1000000000;
+  bool preprocess = true, print_stats = false;
+  int arg = 1;
+  for (; arg < argc - 1; arg++) {
+    std::string option = argv[arg];
+    std::string value = (arg + 2 < argc) ? argv[arg + 1] : "";
+    if (option == "--no-preprocess") {
+      preprocess = false;
+      continue;
+    }
+    if (option == "--stats") {
+      print_stats = true;
+      continue;
+    }
+    if (option == "--seed" && !value.empty()) {
+      seed = std::atoll(value.c_str());
+    } else if (option == "--flips" && std::atoll(value.c_str()) > 0) {
+      max_flips = std::atoll(value.c_str());
+    } else if (option == "--budget" && std::atoll(value.c_str()) > 0) {
+      budget = std::atoll(value.c_str());
+    } else {
+      break;
+    }
+    arg++;
+  }
+  if (arg != argc - 1) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--seed N] [--flips N] [--budget N] [--no-preprocess]"
+              << " [--stats] <input_file>" << std::endl;
+    return 1;
+  }
+
+  DPLL solver;
+  solver.dpll(argv[arg], seed, max_flips, budget, preprocess, print_stats);
+
+  return 0;
+}
@@ -0,0 +1,215 @@
+#ifndef LOCAL_H
+#define LOCAL_H
+
+#include "cnf.h"
+
+// stochastic local search (probSAT): starting from a random assignment, it
+// repeatedly picks an unsatisfied clause and flips one of its variables,
+// chosen with a probability that falls with its break count, the number of
+// clauses the flip would make unsatisfied. it cannot prove
+// unsatisfiability, but goes far on large satisfiable random formulas.
+// everything lives in flat arrays: the occurrences of each literal, the
+// number of true literals of each clause with the xor of their variables
+// (the only true variable when there is one), the break count of each
+// variable, and the unsatisfied clauses with their positions for O(1)
+// removal
+class LocalSearch {
+private:
+  const CNF *cnf = nullptr;
+  std::vector<int> occ_start; // literal -> first of its clauses in occ
+  std::vector<int> occ;
+  std::vector<int> num_true;  // clause -> number of true literals
+  std::vector<int> true_xor;  // clause -> xor of the true variables
+  std::vector<int> breaks;    // variable -> clauses broken by a flip
+  std::vector<int> unsat;     // the unsatisfied clauses
+  std::vector<int> where;     // clause -> position in unsat
+  std::vector<double> weight; // break count -> selection weight
+  std::vector<double> probs;  // cumulative weights of the clause picked
+  std::mt19937 rng;
+
+  bool is_true(Lit lit) const {
+    return (assign[var_of(lit)] > 0) != is_neg(lit);
+  }
+
+  void make_unsat(int c) {
+    where[c] = unsat.size();
+    unsat.push_back(c);
+  }
+
+  void make_sat(int c) {
+    int last = unsat.back();
+    unsat[where[c]] = last;
+    where[last] = where[c];
+    unsat.pop_back();
+  }
+
+  // sets a random assignment, or the given phases, and computes the clause
+  // and break counts from scratch
+  void initialize(const std::vector<signed char> *phases) {
+    int n = cnf->num_vars();
+    for (int var = 0; var < n; var++) {
+      bool positive = (phases && (*phases)[var]) ? (*phases)[var] > 0
+                                                 : (rng() & 1);
+      assign[var] = positive ? 1 : -1;
+    }
+    std::fill(breaks.begin(), breaks.end(), 0);
+    unsat.clear();
+    for (int c = 0; c < cnf->num_clauses(); c++) {
+      num_true[c] = 0;
+      true_xor[c] = 0;
+      for (const Lit *lit = cnf->begin(c); lit != cnf->end(c); lit++) {
+        if (is_true(*lit)) {
+          num_true[c]++;
+          true_xor[c] ^= var_of(*lit);
+        }
+      }
+      if (num_true[c] == 0)
+        make_unsat(c);
+      else if (num_true[c] == 1)
+        breaks[true_xor[c]]++;
+    }
+  }
+
+  // flips a variable and updates the counts of the clauses it appears in
+  void flip(int var) {
+    assign[var] = -assign[var];
+    Lit now_true = make_lit(var, assign[var] < 0);
+    for (int k = occ_start[now_true]; k < occ_start[now_true + 1]; k++) {
+      int c = occ[k];
+      if (num_true[c] == 0) {
+        make_sat(c);
+        breaks[var]++;
+      } else if (num_true[c] == 1) {
+        breaks[true_xor[c]]--;
+      }
+      num_true[c]++;
+      true_xor[c] ^= var;
+    }
+    Lit now_false = negate(now_true);
+    for (int k = occ_start[now_false]; k < occ_start[now_false + 1]; k++) {
+      int c = occ[k];
+      num_true[c]--;
+      true_xor[c] ^= var;
+      if (num_true[c] == 0) {
+        make_unsat(c);
+        breaks[var]--;
+      } else if (num_true[c] == 1) {
+        breaks[true_xor[c]]++;
+      }
+    }
+  }
+
+  // picks the variable to flip in an unsatisfied clause of W literals, or of
+  // any size for W = 0. with a constant width the weights stay in registers
+  // and the loops unroll, which matters on formulas of a single width where
+  // this runs for every flip
+  template <int W> int pick(int c) {
+    const Lit *lits = cnf->begin(c);
+    const int n = W ? W : cnf->size(c);
+    double fixed[W ? W : 1];
+    if (!W)
+      probs.resize(n);
+    double *sums = W ? fixed : probs.data();
+    double total = 0;
+    for (int k = 0; k < n; k++) {
+      int b = std::min<int>(breaks[var_of(lits[k])], weight.size() - 1);
+      total += weight[b];
+      sums[k] = total;
+    }
+    double r = std::uniform_real_distribution<double>(0, total)(rng);
+    int k = 0;
+    while (k + 1 < n && sums[k] < r)
+      k++;
+    return var_of(lits[k]);
+  }
+
+  int pick(int c) {
+    switch (cnf->size(c)) {
+    case 2:
+      return pick<2>(c);
+    case 3:
+      return pick<3>(c);
+    default:
+      return pick<0>(c);
+    }
+  }
+
+public:
+  // the polynomial probSAT weight (eps + break)^-cb, with the constants
+  // tuned for random 3-SAT
+  double cb = 2.06, eps = 0.9;
+
+  std::vector<signed char> assign; // variable -> 1 true, -1 false
+  std::vector<signed char> best;   // the assignment with fewest unsatisfied
+  size_t best_unsat = SIZE_MAX;
+  long long n_flips = 0;
+  // the formula holds an empty clause, which no flip can satisfy, so the
+  // search is not started
+  bool contradiction = false;
+
+  void load(const CNF &formula, unsigned seed = 0) {
+    cnf = &formula;
+    rng.seed(seed);
+    int n = formula.num_vars();
+    occ_start.assign(2 * n + 1, 0);
+    for (Lit lit : formula.lits)
+      occ_start[lit + 1]++;
+    for (int lit = 0; lit < 2 * n; lit++)
+      occ_start[lit + 1] += occ_start[lit];
+    occ.resize(formula.lits.size());
+    std::vector<int> fill(occ_start.begin(), occ_start.end() - 1);
+    for (int c = 0; c < formula.num_clauses(); c++)
+      for (const Lit *lit = formula.begin(c); lit != formula.end(c); lit++)
+        occ[fill[*lit]++] = c;
+
+    contradiction = false;
+    for (int c = 0; c < formula.num_clauses(); c++)
+      if (formula.size(c) == 0)
+        contradiction = true;
+
+    num_true.assign(formula.num_clauses(), 0);
+    true_xor.assign(formula.num_clauses(), 0);
+    where.assign(formula.num_clauses(), 0);
+    breaks.assign(n, 0);
+    assign.assign(n, 1);
+    weight.resize(64);
+    for (size_t b = 0; b < weight.size(); b++)
+      weight[b] = std::pow(eps + b, -cb);
+  }
+
+  // runs tries of max_flips flips each until a model is found, the flip
+  // budget is spent or stop is set. the first try starts from the phases
+  // when given. returns true with the model in assign
+  bool solve(long long max_flips, long long budget,
+             const std::vector<signed char> *phases = nullptr,
+             const std::atomic<bool> *stop = nullptr) {
+    if (contradiction)
+      return false;
+    for (long long spent = 0; spent < budget; spent += max_flips) {
+      initialize(spent == 0 ? phases : nullptr);
+      long long flips = std::min(max_flips, budget - spent);
+      for (long long i = 0; i < flips && !unsat.empty(); i++) {
+        // the best assignment is only sampled, copying it on every
+        // improvement would cost more than the search early on
+        if ((i & 1023) == 0) {
+          if (unsat.size() < best_unsat) {
+            best_unsat = unsat.size();
+            best = assign;
+          }
+          if (stop && stop->load(std::memory_order_relaxed))
+            return false;
+        }
+        flip(pick(unsat[rng() % unsat.size()]));
+        n_flips++;
+      }
+      if (unsat.empty()) {
+        best_unsat = 0;
+        best = assign;
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+#endif
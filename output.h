@@ -0,0 +1,188 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include "cnf.h"
+
+// collects the output in one large buffer and hands it to the stream in big
+// blocks, when the buffer is full and when the writer goes away
+class BufferedWriter {
+private:
+  std::ostream &out;
+  std::string buffer;
+
+public:
+  static constexpr size_t CAPACITY = 1 << 16;
+
+  explicit BufferedWriter(std::ostream &stream) : out(stream) {
+    buffer.reserve(CAPACITY);
+  }
+  ~BufferedWriter() { flush(); }
+
+  void put(char ch) {
+    buffer.push_back(ch);
+    if (buffer.size() >= CAPACITY)
+      flush();
+  }
+
+  void write(const std::string &text) {
+    buffer += text;
+    if (buffer.size() >= CAPACITY)
+      flush();
+  }
+
+  size_t pending() const { return buffer.size(); }
+
+  void flush() {
+    out.write(buffer.data(), buffer.size());
+    out.flush();
+    buffer.clear();
+  }
+};
+
+// writes the assignment the same way as before: true variables, then the
+// false ones prefixed with '~', each group sorted by name.
+// value[var] is 1 for true, -1 for false and 0 for unassigned.
+inline void write_model(const std::string &filename, const CNF &cnf,
+                        const std::vector<signed char> &value) {
+  std::vector<int> order(cnf.num_vars());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&cnf](int a, int b) { return cnf.names[a] < cnf.names[b]; });
+
+  std::ofstream output(filename);
+  BufferedWriter writer(output);
+  for (int var : order) {
+    if (value[var] > 0) {
+      writer.write(cnf.names[var]);
+      writer.put('\n');
+    }
+  }
+  for (int var : order) {
+    if (value[var] < 0) {
+      writer.put('~');
+      writer.write(cnf.names[var]);
+      writer.put('\n');
+    }
+  }
+}
+
+// writes an assignment as "v" lines of at most 78 columns, or lines
+// starting with another tag: the given variables, all of them when vars is
+// empty, negative if false, ending with 0. the variables are given by
+// their names, the numbers of a DIMACS input
+inline void write_values(BufferedWriter &writer, const CNF &cnf,
+                         const std::vector<signed char> &value,
+                         const std::vector<int> &vars = {},
+                         const std::string &tag = "v") {
+  const size_t width = 78;
+  std::string line = tag;
+  auto append = [&](const std::string &lit) {
+    if (line.size() + 1 + lit.size() > width) {
+      writer.write(line);
+      writer.put('\n');
+      line = tag;
+    }
+    line += ' ';
+    line += lit;
+  };
+  auto print = [&](int var) {
+    append(value[var] < 0 ? "-" + cnf.names[var] : cnf.names[var]);
+  };
+  if (vars.empty()) {
+    for (int var = 0; var < cnf.num_vars(); var++)
+      print(var);
+  } else {
+    for (int var : vars)
+      print(var);
+  }
+  append("0");
+  writer.write(line);
+  writer.put('\n');
+}
+
+// prints the answer as in the SAT competition: an "s" line, and for a
+// model "v" lines listing every variable
+inline void write_solution(std::ostream &out, bool satisfiable,
+                           const CNF &cnf,
+                           const std::vector<signed char> &value) {
+  BufferedWriter writer(out);
+  writer.write(satisfiable ? "s SATISFIABLE\n" : "s UNSATISFIABLE\n");
+  if (satisfiable)
+    write_values(writer, cnf, value);
+}
+
+// what a search stopped by its budget leaves for a later run: the
+// literals it fixed at the root, which follow from the formula, and the
+// fullest assignment it reached, to decide the variables with first
+struct Partial {
+  std::vector<Lit> units;
+  std::vector<signed char> assign; // variable -> 1, -1, or 0 if unset
+};
+
+// writes a Partial as "u" lines with the units and "v" lines with the
+// assignment, in the format of write_values. false if the file cannot be
+// written
+inline bool write_partial(const std::string &filename, const CNF &cnf,
+                          const Partial &partial) {
+  std::ofstream output(filename);
+  if (!output) {
+    std::cerr << "Error opening file " << filename << std::endl;
+    return false;
+  }
+  BufferedWriter writer(output);
+  writer.write("c partial search, for --resume\n");
+  std::vector<signed char> value(cnf.num_vars(), 0);
+  std::vector<int> vars;
+  for (Lit lit : partial.units) {
+    value[var_of(lit)] = is_neg(lit) ? -1 : 1;
+    vars.push_back(var_of(lit));
+  }
+  std::sort(vars.begin(), vars.end());
+  // write_values takes no variables for all of them
+  if (!vars.empty())
+    write_values(writer, cnf, value, vars, "u");
+  vars.clear();
+  for (int var = 0; var < (int)partial.assign.size(); var++)
+    if (partial.assign[var] != 0)
+      vars.push_back(var);
+  if (!vars.empty())
+    write_values(writer, cnf, partial.assign, vars);
+  return true;
+}
+
+// reads a file of write_partial back. false if it cannot be read or names
+// a variable the formula does not have
+inline bool read_partial(const std::string &filename, const CNF &cnf,
+                         Partial &partial) {
+  std::ifstream input(filename);
+  if (!input) {
+    std::cerr << "Error opening file " << filename << std::endl;
+    return false;
+  }
+  partial.units.clear();
+  partial.assign.assign(cnf.num_vars(), 0);
+  for (std::string line; std::getline(input, line);) {
+    std::istringstream tokens(line);
+    std::string tag, token;
+    if (!(tokens >> tag) || (tag != "u" && tag != "v"))
+      continue;
+    while (tokens >> token) {
+      if (token == "0")
+        continue;
+      bool negative = token[0] == '-';
+      int var = cnf.find(negative ? token.substr(1) : token);
+      if (var < 0) {
+        std::cerr << "Unknown variable " << token << " in " << filename
+                  << std::endl;
+        return false;
+      }
+      if (tag == "u")
+        partial.units.push_back(make_lit(var, negative));
+      else
+        partial.assign[var] = negative ? -1 : 1;
+    }
+  }
+  return true;
+}
+
+#endif
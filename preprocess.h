@@ -0,0 +1,459 @@
+#ifndef PREPROCESS_H
+#define PREPROCESS_H
+
+#include "solver.h"
+
+// one-time simplification of a formula before search: failed literal
+// probing, equivalent literal substitution, subsumption with self-subsuming
+// resolution and bounded variable elimination. the clauses removed for an
+// eliminated variable go on a reconstruction stack, from which extend turns
+// a model of the simplified formula into a model of the original one.
+class Preprocessor {
+private:
+  std::vector<std::vector<Lit>> clauses;
+  std::vector<char> removed;
+  std::vector<std::vector<int>> occ; // literal -> clauses, may be stale
+  std::vector<signed char> fixed;    // variable -> forced value, 0 if none
+  std::vector<char> eliminated;
+  std::vector<Lit> units; // fixed literals not propagated yet
+  std::vector<char> mark; // literal -> scratch flag
+  bool ok = true;
+
+  // reconstruction stack: entry k is the clause
+  // stack_lits[stack_start[k]..stack_start[k + 1]) and the literal to make
+  // true if the model does not satisfy it
+  std::vector<Lit> stack_lits;
+  std::vector<int> stack_start{0};
+  std::vector<Lit> witness;
+
+  // a variable with more than max_occ occurrences of both signs is not
+  // eliminated, and neither is one that needs a resolvent longer than
+  // max_resolvent
+  const size_t max_occ = 16, max_resolvent = 20;
+  const long long probe_budget = 10000000;
+
+  int value(Lit lit) const {
+    return is_neg(lit) ? -fixed[var_of(lit)] : fixed[var_of(lit)];
+  }
+
+  bool contains(int c, Lit lit) const {
+    return std::find(clauses[c].begin(), clauses[c].end(), lit) !=
+           clauses[c].end();
+  }
+
+  void assign_unit(Lit lit) {
+    if (value(lit) > 0)
+      return;
+    if (value(lit) < 0) {
+      ok = false;
+      return;
+    }
+    fixed[var_of(lit)] = is_neg(lit) ? -1 : 1;
+    units.push_back(lit);
+  }
+
+  // adds a clause without repeated literals, tautologies are dropped and
+  // units are fixed
+  void add(std::vector<Lit> clause) {
+    std::sort(clause.begin(), clause.end());
+    clause.erase(std::unique(clause.begin(), clause.end()), clause.end());
+    for (size_t k = 1; k < clause.size(); k++)
+      if (clause[k] == negate(clause[k - 1]))
+        return;
+    if (clause.empty()) {
+      ok = false;
+      return;
+    }
+    if (clause.size() == 1) {
+      assign_unit(clause[0]);
+      return;
+    }
+    int c = clauses.size();
+    for (Lit lit : clause)
+      occ[lit].push_back(c);
+    clauses.push_back(std::move(clause));
+    removed.push_back(0);
+  }
+
+  // removes a literal from a clause, fixing it if it becomes a unit
+  void strengthen(int c, Lit lit) {
+    auto &clause = clauses[c];
+    clause.erase(std::find(clause.begin(), clause.end(), lit));
+    if (clause.empty()) {
+      ok = false;
+    } else if (clause.size() == 1) {
+      assign_unit(clause[0]);
+      removed[c] = 1;
+    }
+  }
+
+  // deletes the clauses satisfied by the fixed literals and removes the
+  // false literals from the others
+  void propagate() {
+    while (ok && !units.empty()) {
+      Lit lit = units.back();
+      units.pop_back();
+      for (int c : occ[lit])
+        if (!removed[c] && contains(c, lit))
+          removed[c] = 1;
+      for (int c : occ[negate(lit)])
+        if (ok && !removed[c] && contains(c, negate(lit)))
+          strengthen(c, negate(lit));
+      occ[lit].clear();
+      occ[negate(lit)].clear();
+    }
+  }
+
+  void push_reconstruction(const std::vector<Lit> &clause, Lit lit) {
+    stack_lits.insert(stack_lits.end(), clause.begin(), clause.end());
+    stack_start.push_back(stack_lits.size());
+    witness.push_back(lit);
+  }
+
+  // assumes each literal in turn, a literal whose propagation conflicts is
+  // failed and its negation is fixed
+  void probe() {
+    Solver solver;
+    solver.init(fixed.size());
+    for (size_t c = 0; c < clauses.size(); c++)
+      if (!removed[c])
+        solver.add_clause(clauses[c]);
+    if (solver.propagate() != Solver::NO_REASON)
+      solver.ok = false;
+
+    for (int var = 0; var < (int)fixed.size() && solver.ok; var++) {
+      if (fixed[var])
+        continue;
+      for (int sign = 0; sign < 2 && solver.ok; sign++) {
+        if (solver.n_prop > probe_budget)
+          break;
+        Lit lit = make_lit(var, sign);
+        if (solver.value(lit) != 0)
+          continue;
+        solver.decide(lit);
+        int conflict = solver.propagate();
+        solver.backtrack(0);
+        if (conflict == Solver::NO_REASON)
+          continue;
+        solver.enqueue(negate(lit), Solver::NO_REASON);
+        if (solver.propagate() != Solver::NO_REASON)
+          solver.ok = false;
+      }
+    }
+
+    if (!solver.ok) {
+      ok = false;
+      return;
+    }
+    for (Lit lit : solver.trail)
+      assign_unit(lit);
+    propagate();
+  }
+
+  // finds the strongly connected components of the binary implication
+  // graph. the literals of a component are equivalent and are replaced by
+  // the one with the lowest variable
+  void substitute_equivalences() {
+    int n = occ.size();
+    std::vector<std::vector<Lit>> implies(n);
+    for (size_t c = 0; c < clauses.size(); c++) {
+      if (removed[c] || clauses[c].size() != 2)
+        continue;
+      Lit a = clauses[c][0], b = clauses[c][1];
+      implies[negate(a)].push_back(b);
+      implies[negate(b)].push_back(a);
+    }
+
+    // iterative tarjan
+    std::vector<int> index(n, -1), low(n, 0), rep(n);
+    std::vector<char> on_stack(n, 0);
+    std::vector<Lit> stack;
+    std::vector<std::pair<Lit, size_t>> calls;
+    int counter = 0;
+    for (Lit root = 0; root < n; root++) {
+      if (index[root] >= 0)
+        continue;
+      calls.push_back({root, 0});
+      while (!calls.empty()) {
+        auto &[lit, next] = calls.back();
+        if (next == 0) {
+          index[lit] = low[lit] = counter++;
+          stack.push_back(lit);
+          on_stack[lit] = 1;
+        }
+        if (next < implies[lit].size()) {
+          Lit to = implies[lit][next++];
+          if (index[to] < 0)
+            calls.push_back({to, 0});
+          else if (on_stack[to])
+            low[lit] = std::min(low[lit], index[to]);
+          continue;
+        }
+        if (low[lit] == index[lit]) {
+          // pop the component, its representative has the lowest variable
+          size_t top = stack.size();
+          while (stack[--top] != lit)
+            ;
+          Lit best = lit;
+          for (size_t k = top; k < stack.size(); k++)
+            if (var_of(stack[k]) < var_of(best))
+              best = stack[k];
+          for (size_t k = top; k < stack.size(); k++) {
+            rep[stack[k]] = best;
+            on_stack[stack[k]] = 0;
+          }
+          stack.resize(top);
+        }
+        Lit done = lit;
+        calls.pop_back();
+        if (!calls.empty())
+          low[calls.back().first] =
+              std::min(low[calls.back().first], low[done]);
+      }
+    }
+
+    std::vector<int> touched;
+    for (int var = 0; var < n / 2; var++) {
+      Lit lit = make_lit(var, false);
+      if (rep[lit] == lit)
+        continue;
+      if (var_of(rep[lit]) == var) {
+        // the variable is equivalent to its own negation
+        ok = false;
+        return;
+      }
+      // var = rep, restored by the two clauses of the equivalence
+      Lit r = rep[lit];
+      push_reconstruction({lit, negate(r)}, lit);
+      push_reconstruction({negate(lit), r}, negate(lit));
+      eliminated[var] = 1;
+      for (Lit l : {lit, negate(lit)})
+        for (int c : occ[l])
+          if (!removed[c] && contains(c, l))
+            touched.push_back(c);
+    }
+
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+    for (int c : touched) {
+      std::vector<Lit> clause;
+      for (Lit l : clauses[c])
+        clause.push_back(eliminated[var_of(l)] ? rep[l] : l);
+      removed[c] = 1;
+      add(clause);
+      if (!ok)
+        return;
+    }
+    propagate();
+  }
+
+  // removes the clauses subsumed by a smaller one, and strengthens the
+  // clauses that contain a smaller one with a single literal negated
+  void subsume() {
+    std::vector<int> order;
+    for (size_t c = 0; c < clauses.size(); c++)
+      if (!removed[c])
+        order.push_back(c);
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+      return clauses[a].size() < clauses[b].size();
+    });
+
+    for (int c : order) {
+      if (!ok)
+        return;
+      if (removed[c])
+        continue;
+      // the candidates share the literal with the fewest occurrences
+      Lit best = clauses[c][0];
+      for (Lit lit : clauses[c])
+        if (occ[lit].size() + occ[negate(lit)].size() <
+            occ[best].size() + occ[negate(best)].size())
+          best = lit;
+
+      for (Lit lit : clauses[c])
+        mark[lit] = 1;
+      for (Lit l : {best, negate(best)}) {
+        std::vector<int> candidates = occ[l];
+        for (int d : candidates) {
+          if (d == c || removed[d] || removed[c] ||
+              clauses[d].size() < clauses[c].size())
+            continue;
+          size_t same = 0, flipped = 0;
+          Lit flip = 0;
+          for (Lit lit : clauses[d]) {
+            if (mark[lit]) {
+              same++;
+            } else if (mark[negate(lit)]) {
+              flipped++;
+              flip = lit;
+            }
+          }
+          if (same == clauses[c].size())
+            removed[d] = 1;
+          else if (same + 1 == clauses[c].size() && flipped == 1)
+            strengthen(d, flip);
+        }
+      }
+      for (Lit lit : clauses[c])
+        mark[lit] = 0;
+    }
+    propagate();
+  }
+
+  // resolves away variables whose resolvents are no more numerous than the
+  // clauses they replace
+  void eliminate() {
+    int n = fixed.size();
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+      return occ[2 * a].size() + occ[2 * a + 1].size() <
+             occ[2 * b].size() + occ[2 * b + 1].size();
+    });
+
+    std::vector<std::vector<Lit>> resolvents;
+    for (int var : order) {
+      if (!ok)
+        return;
+      if (fixed[var] || eliminated[var])
+        continue;
+      Lit pos = make_lit(var, false), neg = make_lit(var, true);
+      std::vector<int> with_pos, with_neg;
+      for (int c : occ[pos])
+        if (!removed[c] && contains(c, pos))
+          with_pos.push_back(c);
+      for (int c : occ[neg])
+        if (!removed[c] && contains(c, neg))
+          with_neg.push_back(c);
+      if (with_pos.empty() && with_neg.empty())
+        continue;
+      if (with_pos.size() > max_occ && with_neg.size() > max_occ)
+        continue;
+
+      if (!resolve_all(var, with_pos, with_neg, resolvents))
+        continue;
+
+      for (int c : with_pos) {
+        push_reconstruction(clauses[c], pos);
+        removed[c] = 1;
+      }
+      for (int c : with_neg) {
+        push_reconstruction(clauses[c], neg);
+        removed[c] = 1;
+      }
+      eliminated[var] = 1;
+      for (auto &resolvent : resolvents)
+        add(resolvent);
+      propagate();
+    }
+  }
+
+  // collects the non tautological resolvents on var, returns false if
+  // there are too many or they are too long
+  bool resolve_all(int var, const std::vector<int> &with_pos,
+                   const std::vector<int> &with_neg,
+                   std::vector<std::vector<Lit>> &resolvents) {
+    resolvents.clear();
+    size_t limit = with_pos.size() + with_neg.size();
+    for (int p : with_pos) {
+      for (Lit lit : clauses[p])
+        mark[lit] = 1;
+      for (int q : with_neg) {
+        std::vector<Lit> resolvent;
+        bool tautology = false;
+        for (Lit lit : clauses[q]) {
+          if (var_of(lit) == var)
+            continue;
+          if (mark[negate(lit)]) {
+            tautology = true;
+            break;
+          }
+          if (!mark[lit])
+            resolvent.push_back(lit);
+        }
+        if (tautology)
+          continue;
+        for (Lit lit : clauses[p])
+          if (var_of(lit) != var)
+            resolvent.push_back(lit);
+        if (resolvents.size() == limit || resolvent.size() > max_resolvent) {
+          for (Lit lit : clauses[p])
+            mark[lit] = 0;
+          return false;
+        }
+        resolvents.push_back(std::move(resolvent));
+      }
+      for (Lit lit : clauses[p])
+        mark[lit] = 0;
+    }
+    return true;
+  }
+
+public:
+  int n_fixed = 0, n_eliminated = 0;
+
+  // simplifies the formula in place, the variables keep their numbering.
+  // returns false if it is found unsatisfiable
+  bool run(CNF &cnf) {
+    int n = cnf.num_vars();
+    fixed.assign(n, 0);
+    eliminated.assign(n, 0);
+    occ.assign(2 * n, {});
+    mark.assign(2 * n, 0);
+    for (int c = 0; c < cnf.num_clauses() && ok; c++)
+      add(std::vector<Lit>(cnf.begin(c), cnf.end(c)));
+
+    propagate();
+    if (ok)
+      probe();
+    if (ok)
+      substitute_equivalences();
+    if (ok)
+      subsume();
+    if (ok)
+      eliminate();
+    if (!ok)
+      return false;
+
+    cnf.lits.clear();
+    cnf.start.assign(1, 0);
+    for (size_t c = 0; c < clauses.size(); c++)
+      if (!removed[c])
+        cnf.add_clause(clauses[c]);
+
+    for (int var = 0; var < n; var++) {
+      n_fixed += fixed[var] != 0;
+      n_eliminated += eliminated[var];
+    }
+    return true;
+  }
+
+  // turns a model of the simplified formula into one of the original: the
+  // fixed variables get their value, then the reconstruction stack is
+  // replayed backwards, making the witness true for every clause the model
+  // does not satisfy
+  void extend(std::vector<signed char> &model) const {
+    for (size_t var = 0; var < fixed.size(); var++) {
+      if (fixed[var])
+        model[var] = fixed[var];
+      else if (eliminated[var] && !model[var])
+        model[var] = -1;
+    }
+
+    for (size_t k = witness.size(); k-- > 0;) {
+      bool satisfied = false;
+      for (int i = stack_start[k]; i < stack_start[k + 1]; i++) {
+        Lit lit = stack_lits[i];
+        int v = is_neg(lit) ? -model[var_of(lit)] : model[var_of(lit)];
+        if (v > 0) {
+          satisfied = true;
+          break;
+        }
+      }
+      if (!satisfied)
+        model[var_of(witness[k])] = is_neg(witness[k]) ? -1 : 1;
+    }
+  }
+};
+
+#endif
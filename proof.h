@@ -0,0 +1,140 @@
+#ifndef PROOF_H
+#define PROOF_H
+
+#include "cnf.h"
+
+// streams a binary DRAT proof: every learned clause is added with 'a' and
+// every deleted one removed with 'd', the literals as variable-length
+// integers 2 * v + sign with v the number of the variable in the input,
+// which is its name, and a 0 byte ends each clause. the clauses are
+// encoded into a chunk under a mutex, so that the clauses of parallel
+// engines keep the order they were learned in, and full chunks go through a
+// bounded queue to a thread that writes them out. the solver only waits
+// when the writer falls QUEUE_CHUNKS behind
+class ProofWriter {
+public:
+  static constexpr size_t CHUNK_SIZE = 1 << 20;
+  static constexpr size_t QUEUE_CHUNKS = 16;
+
+private:
+  FILE *file = nullptr;
+  std::mutex mtx;
+  std::condition_variable queued, drained;
+  std::deque<std::string> chunks;
+  std::string chunk;
+  bool closing = false;
+  std::thread writer;
+
+  // variable -> its number in the input. the variables past the formula,
+  // which the engines may add, are numbered from past_number on
+  std::vector<unsigned> numbers;
+  unsigned past_number = 1;
+
+  unsigned number(int var) const {
+    return var < (int)numbers.size() ? numbers[var]
+                                     : past_number + (var - numbers.size());
+  }
+
+  void encode(char kind, const Lit *begin, const Lit *end) {
+    chunk.push_back(kind);
+    for (const Lit *lit = begin; lit != end; lit++) {
+      unsigned value = 2 * number(var_of(*lit)) + (is_neg(*lit) ? 1 : 0);
+      while (value > 127) {
+        chunk.push_back((char)((value & 127) | 128));
+        value >>= 7;
+      }
+      chunk.push_back((char)value);
+    }
+    chunk.push_back(0);
+  }
+
+  // hands the current chunk to the writer thread, called with the lock
+  void ship(std::unique_lock<std::mutex> &lock) {
+    drained.wait(lock, [this]() { return chunks.size() < QUEUE_CHUNKS; });
+    chunks.push_back(std::move(chunk));
+    chunk.clear();
+    chunk.reserve(CHUNK_SIZE);
+    queued.notify_one();
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+      queued.wait(lock, [this]() { return closing || !chunks.empty(); });
+      if (chunks.empty())
+        return;
+      std::string data = std::move(chunks.front());
+      chunks.pop_front();
+      drained.notify_all();
+      lock.unlock();
+      fwrite(data.data(), 1, data.size(), file);
+      lock.lock();
+    }
+  }
+
+public:
+  // opens the proof file and starts the writer, returns false on failure.
+  // the variables of the formula must be named by positive numbers, as in
+  // DIMACS, for the proof to be checked against it
+  bool open(const std::string &filename, const CNF &cnf) {
+    numbers.clear();
+    for (const std::string &name : cnf.names) {
+      if (name.empty() || name.size() > 9 || name[0] == '0' ||
+          name.find_first_not_of("0123456789") != std::string::npos) {
+        std::cerr << "A proof needs variables named by numbers, not "
+                  << name << std::endl;
+        return false;
+      }
+      numbers.push_back(std::stoul(name));
+    }
+    past_number = 1;
+    for (unsigned n : numbers)
+      past_number = std::max(past_number, n + 1);
+
+    file = fopen(filename.c_str(), "wb");
+    if (!file) {
+      std::cerr << "Error opening file " << filename << std::endl;
+      return false;
+    }
+    chunk.reserve(CHUNK_SIZE);
+    writer = std::thread(&ProofWriter::run, this);
+    return true;
+  }
+
+  void add(const Lit *begin, const Lit *end) {
+    std::unique_lock<std::mutex> lock(mtx);
+    encode('a', begin, end);
+    if (chunk.size() >= CHUNK_SIZE)
+      ship(lock);
+  }
+  void add(const std::vector<Lit> &clause) {
+    add(clause.data(), clause.data() + clause.size());
+  }
+
+  void remove(const Lit *begin, const Lit *end) {
+    std::unique_lock<std::mutex> lock(mtx);
+    encode('d', begin, end);
+    if (chunk.size() >= CHUNK_SIZE)
+      ship(lock);
+  }
+
+  // writes out what is left and waits for the writer
+  void close() {
+    if (!file)
+      return;
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      if (!chunk.empty())
+        ship(lock);
+      closing = true;
+    }
+    queued.notify_one();
+    writer.join();
+    fclose(file);
+    file = nullptr;
+  }
+
+  ~ProofWriter() { close(); }
+};
+
+#endif
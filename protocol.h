@@ -0,0 +1,121 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <bits/stdc++.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// the framing spoken over the UNIX socket of the solver daemon. a message
+// is a header line, a command, the size of the body in bytes and maybe
+// more fields, all separated by spaces, followed by the body:
+//   SOLVE <bytes> <format> <timeout_ms>  a formula, DIMACS (or one clause
+//                                        per line) for format dimacs, the
+//                                        framing of CNF::to_binary for
+//                                        binary. timeout 0 sets no limit
+//   OK <bytes>                           the answer, as the solvers print it
+//   ERROR <bytes>                        what went wrong
+// a connection carries any number of requests, each answered in turn
+
+const char *const DEFAULT_SOCKET = "/tmp/cdcl.sock";
+// the largest body accepted by default
+const size_t DEFAULT_MAX_BODY = (size_t)256 << 20;
+
+// connects to the socket at path, -1 on failure
+inline int connect_socket(const std::string &path) {
+  sockaddr_un address{};
+  if (path.size() >= sizeof(address.sun_path))
+    return -1;
+  address.sun_family = AF_UNIX;
+  std::strcpy(address.sun_path, path.c_str());
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  if (connect(fd, (sockaddr *)&address, sizeof(address)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+inline bool write_all(int fd, const char *data, size_t size) {
+  while (size > 0) {
+    // a peer that went away gives an error instead of SIGPIPE
+    ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+inline bool read_exact(int fd, char *data, size_t size) {
+  while (size > 0) {
+    ssize_t n = recv(fd, data, size, 0);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+// sends a message, the fields being put after the size
+inline bool send_message(int fd, const std::string &command,
+                         const std::string &body,
+                         const std::string &fields = "") {
+  std::string header = command + " " + std::to_string(body.size());
+  if (!fields.empty())
+    header += " " + fields;
+  header += '\n';
+  return write_all(fd, header.data(), header.size()) &&
+         write_all(fd, body.data(), body.size());
+}
+
+// receives a message: the fields of the header, the command first, and the
+// body. false when the connection is closed or the header is malformed, or
+// when the body is over max_body, which is refused before anything is
+// allocated for it. fields only holds the header in that last case
+inline bool receive_message(int fd, std::vector<std::string> &fields,
+                            std::string &body,
+                            size_t max_body = DEFAULT_MAX_BODY) {
+  // the header is short, so it is read a byte at a time rather than
+  // buffered past its end
+  fields.clear();
+  std::string header;
+  char ch;
+  while (true) {
+    if (!read_exact(fd, &ch, 1))
+      return false;
+    if (ch == '\n')
+      break;
+    if (header.size() >= 1024)
+      return false;
+    header += ch;
+  }
+  std::istringstream iss(header);
+  for (std::string field; iss >> field;)
+    fields.push_back(field);
+  if (fields.size() < 2 ||
+      fields[1].find_first_not_of("0123456789") != std::string::npos ||
+      fields[1].size() > 12) {
+    fields.clear();
+    return false;
+  }
+  size_t size = std::stoull(fields[1]);
+  if (size > max_body)
+    return false;
+  body.resize(size);
+  if (!read_exact(fd, &body[0], size)) {
+    fields.clear();
+    return false;
+  }
+  return true;
+}
+
+#endif
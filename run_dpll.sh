@@ -1,7 +1,9 @@
 #!/bin/bash
 
-# Path to the folder containing the .cnf files
-folder="$HOME/Desktop/SAT_SOLVER/TESTCASES/LRAN"
+# Path to the folder containing the .cnf files, the LRAN suite next to this
+# script unless another folder is given. benchmark.py runs the suites with
+# timeouts and records the results
+folder="${1:-$(dirname "$0")/TESTCASES/LRAN}"
 
 # Loop through all .cnf files in the folder
 for file in "$folder"/*.cnf; do
@@ -0,0 +1,512 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "proof.h"
+
+// an entry of a watch list, what propagation knows about a clause without
+// reading the arena, in 8 bytes. a binary clause is decided from the entry
+// alone, blocker being its other literal. a longer clause only needs its
+// literals when blocker, one of them, is not true. a cardinality constraint
+// is always read
+struct Watch {
+  enum Kind { BINARY, CLAUSE, AT_MOST };
+
+  unsigned cref : 30;
+  unsigned kind : 2;
+  Lit blocker;
+
+  Watch() = default;
+  Watch(int ref, Kind type, Lit lit) : cref(ref), kind(type), blocker(lit) {}
+};
+
+// in-place propagation engine: watched literals, an assignment trail and
+// backtracking to a decision level.
+// clauses are stored in one arena, a clause reference is the offset of its
+// header. the header is the size, the flags (learnt, deleted, cardinality,
+// and the LBD of a learnt clause or the bound of a cardinality constraint)
+// and the activity, and the literals follow it.
+// the first two literals of a clause are the watched ones. binary clauses,
+// most of the learned clauses and of many encodings, never need the arena
+// to be propagated; their literals are only put in order, implied literal
+// first, when explain needs them.
+// a cardinality constraint says that at most bound of its literals are true.
+// it is watched on every literal, and stands for the clauses made of the
+// negations of any bound + 1 of them, which explain builds when one is needed
+// as a reason or a conflict.
+// the arena is never given back: deleted clauses are squeezed out in place
+// and their room is reused by the next learned clauses, so once the search
+// has warmed up it no longer allocates.
+class Solver {
+public:
+  static constexpr int NO_REASON = -1;
+  static constexpr int HEADER = 3;
+
+  std::vector<Lit> arena;
+  std::vector<int> clauses; // references of the input clauses and constraints
+  std::vector<int> learnts;              // references of the learnt clauses
+  std::vector<std::vector<Watch>> watches; // literal -> clauses watching it
+  size_t wasted = 0; // arena words held by deleted clauses
+
+  double cla_inc = 1.0;
+  const double cla_decay = 0.999;
+
+  std::vector<signed char> assign; // variable -> 1 true, -1 false, 0 unset
+  std::vector<int> level;          // variable -> decision level
+  std::vector<int> reason;         // variable -> implying clause
+  std::vector<signed char> phase;  // variable -> last value, 0 if never set
+  std::vector<Lit> trail;          // assigned literals in order
+  std::vector<int> trail_lim;      // trail size at each decision
+  size_t qhead = 0;                // next trail literal to propagate
+
+  bool ok = true; // false once the formula is unsatisfiable at level 0
+  long long n_prop = 0;
+
+  ProofWriter *proof = nullptr; // receives the deleted learned clauses
+
+  std::vector<Lit> explanation; // the clause last built by explain
+
+private:
+  // scratch space kept between calls so that they do not allocate
+  std::vector<Lit> scratch;
+  std::vector<int> candidates;
+  std::vector<float> saved_activity;
+
+public:
+
+  int num_vars() const { return assign.size(); }
+  int decision_level() const { return trail_lim.size(); }
+  int size(int cref) const { return arena[cref]; }
+  Lit *lits(int cref) { return arena.data() + cref + HEADER; }
+  bool learnt(int cref) const { return arena[cref + 1] & 1; }
+  bool deleted(int cref) const { return arena[cref + 1] & 2; }
+  bool cardinality(int cref) const { return arena[cref + 1] & 4; }
+  int lbd(int cref) const { return arena[cref + 1] >> 3; }
+  int bound(int cref) const { return arena[cref + 1] >> 3; }
+
+  float activity(int cref) const {
+    float act;
+    std::memcpy(&act, &arena[cref + 2], sizeof act);
+    return act;
+  }
+  void set_activity(int cref, float act) {
+    std::memcpy(&arena[cref + 2], &act, sizeof act);
+  }
+
+  // literals of the clause behind a conflict or the implication of a
+  // literal, with the implied literal first. a cardinality constraint gives
+  // the implied literal, if any, and the negations of its true literals
+  const Lit *explain(int cref, Lit implied, int &n) {
+    if (!cardinality(cref)) {
+      Lit *c = lits(cref);
+      n = size(cref);
+      if (n == 2 && implied == c[1])
+        std::swap(c[0], c[1]);
+      return c;
+    }
+    explanation.clear();
+    if (implied >= 0)
+      explanation.push_back(implied);
+    const Lit *c = lits(cref);
+    for (int k = 0; k < size(cref); k++)
+      if (value(c[k]) > 0)
+        explanation.push_back(negate(c[k]));
+    n = explanation.size();
+    return explanation.data();
+  }
+
+  // a clause is locked while it is the reason of one of its literals, which
+  // is the first one unless the clause is binary
+  bool locked(int cref) const {
+    int n = size(cref) == 2 ? 2 : 1;
+    for (int k = 0; k < n; k++) {
+      Lit lit = arena[cref + HEADER + k];
+      if (value(lit) > 0 && reason[var_of(lit)] == cref)
+        return true;
+    }
+    return false;
+  }
+
+  // value of a literal: 1 true, -1 false, 0 unassigned
+  int value(Lit lit) const {
+    return is_neg(lit) ? -assign[var_of(lit)] : assign[var_of(lit)];
+  }
+
+  void init(int num_vars) {
+    assign.assign(num_vars, 0);
+    level.assign(num_vars, 0);
+    reason.assign(num_vars, NO_REASON);
+    phase.assign(num_vars, 0);
+    watches.assign(2 * num_vars, {});
+    trail.reserve(num_vars);
+  }
+
+  // adds unassigned variables up to num_vars
+  void grow(int num_vars) {
+    assign.resize(num_vars, 0);
+    level.resize(num_vars, 0);
+    reason.resize(num_vars, NO_REASON);
+    phase.resize(num_vars, 0);
+    watches.resize(2 * num_vars);
+    trail.reserve(num_vars);
+  }
+
+  // copies every clause of the database, returns false on a conflict
+  bool load(const CNF &cnf) {
+    init(cnf.num_vars());
+    arena.reserve(cnf.lits.size() + HEADER * cnf.num_clauses());
+    for (int c = 0; c < cnf.num_clauses() && ok; c++) {
+      scratch.assign(cnf.begin(c), cnf.end(c));
+      add_clause(scratch);
+    }
+    return ok;
+  }
+
+  // stores a clause whose first two literals are watched and returns its
+  // reference
+  int attach(const std::vector<Lit> &clause, bool is_learnt = false,
+             int lbd = 0) {
+    int cref = arena.size();
+    arena.push_back(clause.size());
+    arena.push_back((lbd << 3) | (is_learnt ? 1 : 0));
+    arena.push_back(0);
+    set_activity(cref, 0.0f);
+    arena.insert(arena.end(), clause.begin(), clause.end());
+    Watch::Kind kind = clause.size() == 2 ? Watch::BINARY : Watch::CLAUSE;
+    watches[clause[0]].emplace_back(cref, kind, clause[1]);
+    watches[clause[1]].emplace_back(cref, kind, clause[0]);
+    (is_learnt ? learnts : clauses).push_back(cref);
+    return cref;
+  }
+
+  // adds a constraint that at most bound of the literals are true, at level
+  // 0. the literals must be distinct variables
+  bool add_at_most(const std::vector<Lit> &constraint, int bound) {
+    if (!ok)
+      return false;
+    std::vector<Lit> open;
+    for (Lit lit : constraint) {
+      if (value(lit) > 0)
+        bound--;
+      else if (value(lit) == 0)
+        open.push_back(lit);
+    }
+    if (bound < 0)
+      return ok = false;
+    if ((int)open.size() <= bound)
+      return true;
+    if (bound == 0) {
+      for (Lit lit : open)
+        enqueue(negate(lit), NO_REASON);
+      return true;
+    }
+
+    int cref = arena.size();
+    arena.push_back(open.size());
+    arena.push_back((bound << 3) | 4);
+    arena.push_back(0);
+    set_activity(cref, 0.0f);
+    arena.insert(arena.end(), open.begin(), open.end());
+    // visited when one of the literals becomes true
+    for (Lit lit : open)
+      watches[negate(lit)].emplace_back(cref, Watch::AT_MOST, lit);
+    clauses.push_back(cref);
+    return true;
+  }
+
+  void bump_clause(int cref) {
+    set_activity(cref, activity(cref) + cla_inc);
+    if (activity(cref) > 1e20f) {
+      for (int learnt : learnts)
+        set_activity(learnt, activity(learnt) * 1e-20f);
+      cla_inc *= 1e-20;
+    }
+  }
+
+  void decay_clauses() { cla_inc /= cla_decay; }
+
+  // deletes about half of the learnt clauses, keeping the glue clauses
+  // (LBD <= 2), the locked ones and the most active among the rest.
+  // deleted clauses are dropped from the watch lists right away and the
+  // arena is compacted once they take up half of it
+  void reduce_db() {
+    candidates.clear();
+    for (int cref : learnts)
+      if (lbd(cref) > 2 && !locked(cref))
+        candidates.push_back(cref);
+    std::sort(candidates.begin(), candidates.end(), [this](int a, int b) {
+      if (lbd(a) != lbd(b))
+        return lbd(a) > lbd(b);
+      return activity(a) < activity(b);
+    });
+    candidates.resize(candidates.size() / 2);
+    if (candidates.empty())
+      return;
+
+    for (int cref : candidates) {
+      if (proof)
+        proof->remove(lits(cref), lits(cref) + size(cref));
+      arena[cref + 1] |= 2;
+      wasted += HEADER + size(cref);
+    }
+    learnts.erase(std::remove_if(learnts.begin(), learnts.end(),
+                                 [this](int cref) { return deleted(cref); }),
+                  learnts.end());
+    for (auto &ws : watches)
+      ws.erase(std::remove_if(ws.begin(), ws.end(),
+                              [this](const Watch &w) {
+                                return deleted(w.cref);
+                              }),
+               ws.end());
+
+    if (wasted * 2 > arena.size())
+      collect_garbage();
+  }
+
+  // deletes every clause holding the variable and unassigns it, at level 0,
+  // so that it can be used again as if new. only sound for a variable that
+  // nothing else was derived from, like a selector that only ever appears
+  // negated: its clauses are then satisfied for good once it is false
+  void remove_variable(int var) {
+    bool removed = false;
+    for (auto *list : {&clauses, &learnts}) {
+      for (int cref : *list) {
+        const Lit *c = lits(cref);
+        if (std::none_of(c, c + size(cref),
+                         [var](Lit lit) { return var_of(lit) == var; }))
+          continue;
+        if (proof && learnt(cref))
+          proof->remove(c, c + size(cref));
+        arena[cref + 1] |= 2;
+        wasted += HEADER + size(cref);
+        removed = true;
+      }
+      list->erase(std::remove_if(list->begin(), list->end(),
+                                 [this](int cref) { return deleted(cref); }),
+                  list->end());
+    }
+    if (removed)
+      for (auto &ws : watches)
+        ws.erase(std::remove_if(ws.begin(), ws.end(),
+                                [this](const Watch &w) {
+                                  return deleted(w.cref);
+                                }),
+                 ws.end());
+
+    if (assign[var] != 0) {
+      size_t i = std::find_if(trail.begin(), trail.end(),
+                              [var](Lit lit) { return var_of(lit) == var; }) -
+                 trail.begin();
+      trail.erase(trail.begin() + i);
+      if (i < qhead)
+        qhead--;
+      assign[var] = 0;
+      reason[var] = NO_REASON;
+    }
+
+    if (wasted * 2 > arena.size())
+      collect_garbage();
+  }
+
+  // slides the live clauses down over the deleted ones, keeping their order
+  // and the capacity of the arena. a first walk puts the new place of every
+  // live clause in its activity slot, saving the activities aside, so that
+  // the references can be remapped; a second walk moves the clauses. a
+  // clause only ever moves to a lower offset, over room already walked
+  void collect_garbage() {
+    saved_activity.clear();
+    int to = 0;
+    for (int cref = 0; cref < (int)arena.size();
+         cref += HEADER + size(cref)) {
+      if (deleted(cref))
+        continue;
+      saved_activity.push_back(activity(cref));
+      arena[cref + 2] = to;
+      to += HEADER + size(cref);
+    }
+
+    for (auto *list : {&clauses, &learnts})
+      for (int &cref : *list)
+        cref = arena[cref + 2];
+    for (auto &ws : watches)
+      for (Watch &w : ws)
+        w.cref = arena[w.cref + 2];
+    for (Lit lit : trail)
+      if (reason[var_of(lit)] != NO_REASON)
+        reason[var_of(lit)] = arena[reason[var_of(lit)] + 2];
+
+    size_t live = 0;
+    for (int cref = 0; cref < (int)arena.size();) {
+      int next = cref + HEADER + size(cref);
+      if (!deleted(cref)) {
+        int dest = arena[cref + 2];
+        std::memmove(&arena[dest], &arena[cref],
+                     (HEADER + size(cref)) * sizeof(Lit));
+        set_activity(dest, saved_activity[live++]);
+      }
+      cref = next;
+    }
+    arena.resize(to);
+    wasted = 0;
+  }
+
+  // adds a clause at level 0, units are assigned straight away
+  bool add_clause(const std::vector<Lit> &clause) {
+    if (!ok)
+      return false;
+    if (clause.empty())
+      return ok = false;
+    if (clause.size() == 1) {
+      if (value(clause[0]) < 0)
+        return ok = false;
+      if (value(clause[0]) == 0)
+        enqueue(clause[0], NO_REASON);
+      return true;
+    }
+    attach(clause);
+    return true;
+  }
+
+  void enqueue(Lit lit, int from) {
+    int var = var_of(lit);
+    assign[var] = is_neg(lit) ? -1 : 1;
+    level[var] = decision_level();
+    reason[var] = from;
+    trail.push_back(lit);
+  }
+
+  void new_decision_level() { trail_lim.push_back(trail.size()); }
+
+  // assigns a decision literal on a new level
+  void decide(Lit lit) {
+    new_decision_level();
+    enqueue(lit, NO_REASON);
+  }
+
+  // undoes every assignment above the given level, remembering the values
+  // as the phases to decide the variables with next time
+  void backtrack(int target) {
+    if (decision_level() <= target)
+      return;
+    for (size_t i = trail.size(); i-- > (size_t)trail_lim[target];) {
+      int var = var_of(trail[i]);
+      phase[var] = assign[var];
+      assign[var] = 0;
+      reason[var] = NO_REASON;
+    }
+    trail.resize(trail_lim[target]);
+    trail_lim.resize(target);
+    qhead = trail.size();
+  }
+
+  // propagates the pending trail literals, only visiting the clauses that
+  // watch a literal that became false. returns the conflicting clause, or
+  // NO_REASON if there is none
+  int propagate() {
+    int conflict = NO_REASON;
+    while (qhead < trail.size()) {
+      Lit false_lit = negate(trail[qhead++]);
+      std::vector<Watch> &ws = watches[false_lit];
+      size_t i = 0, j = 0;
+      while (i < ws.size()) {
+        Watch w = ws[i++];
+        int blocked = value(w.blocker);
+
+        if (w.kind == Watch::BINARY) {
+          ws[j++] = w;
+          if (blocked == 0) {
+            n_prop++;
+            enqueue(w.blocker, w.cref);
+          } else if (blocked < 0) {
+            conflict = w.cref;
+            qhead = trail.size();
+            while (i < ws.size())
+              ws[j++] = ws[i++];
+          }
+          continue;
+        }
+
+        if (w.kind == Watch::AT_MOST) {
+          ws[j++] = w;
+          if (!propagate_cardinality(w.cref)) {
+            conflict = w.cref;
+            qhead = trail.size();
+            while (i < ws.size())
+              ws[j++] = ws[i++];
+          }
+          continue;
+        }
+
+        // a true blocker satisfies the clause without reading it
+        if (blocked > 0) {
+          ws[j++] = w;
+          continue;
+        }
+
+        int cref = w.cref;
+        Lit *c = lits(cref);
+        int n = size(cref);
+
+        // keep the false watch in the second position
+        if (c[0] == false_lit)
+          std::swap(c[0], c[1]);
+        w.blocker = c[0];
+        if (value(c[0]) > 0) {
+          ws[j++] = w;
+          continue;
+        }
+
+        // look for a new literal to watch
+        bool moved = false;
+        for (int k = 2; k < n; k++) {
+          if (value(c[k]) >= 0) {
+            std::swap(c[1], c[k]);
+            watches[c[1]].push_back(w);
+            moved = true;
+            break;
+          }
+        }
+        if (moved)
+          continue;
+
+        // the clause is unit or conflicting
+        ws[j++] = w;
+        if (value(c[0]) < 0) {
+          conflict = cref;
+          qhead = trail.size();
+          while (i < ws.size())
+            ws[j++] = ws[i++];
+        } else {
+          n_prop++;
+          enqueue(c[0], cref);
+        }
+      }
+      ws.resize(j);
+    }
+    return conflict;
+  }
+
+private:
+  // counts the true literals of a cardinality constraint, one of which just
+  // became true. at the bound the other literals are set false, above it
+  // the constraint is conflicting and false is returned
+  bool propagate_cardinality(int cref) {
+    const Lit *c = lits(cref);
+    int n = size(cref), n_true = 0;
+    for (int k = 0; k < n; k++)
+      if (value(c[k]) > 0)
+        n_true++;
+    if (n_true > bound(cref))
+      return false;
+    if (n_true == bound(cref)) {
+      for (int k = 0; k < n; k++) {
+        if (value(c[k]) == 0) {
+          n_prop++;
+          enqueue(negate(c[k]), cref);
+        }
+      }
+    }
+    return true;
+  }
+};
+
+#endif
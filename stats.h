@@ -0,0 +1,240 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <bits/stdc++.h>
+#include <sys/resource.h>
+
+// counters and phase times of a search. each engine or worker keeps its own
+// and only ever writes to them from its thread, so the hot paths do plain
+// increments; they are summed or published to a Progress when needed
+struct Stats {
+  long long decisions = 0, propagations = 0, conflicts = 0, restarts = 0;
+  // seconds spent in each phase. restart also covers the clause imports
+  // and the reductions of the learned clauses
+  double parse = 0, preprocess = 0, search = 0;
+  double propagate = 0, analyze = 0, restart = 0;
+
+  Stats &operator+=(const Stats &other) {
+    decisions += other.decisions;
+    propagations += other.propagations;
+    conflicts += other.conflicts;
+    restarts += other.restarts;
+    parse += other.parse;
+    preprocess += other.preprocess;
+    search += other.search;
+    propagate += other.propagate;
+    analyze += other.analyze;
+    restart += other.restart;
+    return *this;
+  }
+
+  // the counters, printed at the end of every run
+  void print_counters(std::ostream &out) const {
+    out << "Decisions: " << decisions << std::endl;
+    out << "Propagations: " << propagations << std::endl;
+    out << "Conflicts: " << conflicts << std::endl;
+  }
+
+  // the --stats summary: the time of every phase and the rates
+  void print(std::ostream &out) const {
+    auto rate = [this](long long count) {
+      return search > 0 ? (long long)(count / search) : 0;
+    };
+    out << std::fixed << std::setprecision(3);
+    out << "Stats:" << std::endl;
+    out << "  parse         " << parse << " s" << std::endl;
+    out << "  preprocess    " << preprocess << " s" << std::endl;
+    out << "  search        " << search << " s" << std::endl;
+    out << "    propagate   " << propagate << " s" << std::endl;
+    out << "    analyze     " << analyze << " s" << std::endl;
+    out << "    restart     " << restart << " s" << std::endl;
+    out << "  decisions     " << decisions << " (" << rate(decisions) << "/s)"
+        << std::endl;
+    out << "  propagations  " << propagations << " ("
+        << rate(propagations) << "/s)" << std::endl;
+    out << "  conflicts     " << conflicts << " (" << rate(conflicts) << "/s)"
+        << std::endl;
+    out << "  restarts      " << restarts << std::endl;
+    out << std::defaultfloat;
+  }
+};
+
+// adds the time until it goes out of scope to a phase of Stats
+class PhaseTimer {
+private:
+  double &phase;
+  std::chrono::steady_clock::time_point start;
+
+public:
+  explicit PhaseTimer(double &slot)
+      : phase(slot), start(std::chrono::steady_clock::now()) {}
+  ~PhaseTimer() {
+    phase += std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                           start)
+                 .count();
+  }
+};
+
+// the exit status of a run stopped by its budget without an answer, next
+// to 0 for an answer and 1 for an error
+const int EXIT_UNKNOWN = 2;
+
+// limits on a search, 0 for none: the wall time since the budget was made,
+// the decisions and conflicts of all the workers together, and the peak
+// resident memory of the process. a worker compares its own counts with the
+// limits at every step, and once every CHECK_INTERVAL steps adds them to the
+// shared totals and reads the clock and the memory, so a count limit is
+// exact with one worker and overshot by at most that many steps per worker
+// with more
+class Budget {
+public:
+  enum Limit { NONE, TIME, CONFLICTS, DECISIONS, MEMORY };
+  static constexpr int CHECK_INTERVAL = 1024;
+
+  double seconds = 0;
+  long long conflicts = 0, decisions = 0;
+  long long megabytes = 0;
+
+private:
+  std::chrono::steady_clock::time_point begin =
+      std::chrono::steady_clock::now();
+  std::atomic<long long> used_decisions{0}, used_conflicts{0};
+  std::atomic<int> reason{NONE};
+
+  // the first limit to run out is the one reported
+  void exhaust(Limit limit) {
+    int none = NONE;
+    reason.compare_exchange_strong(none, limit);
+  }
+
+  void check_resources() {
+    if (seconds > 0 &&
+        std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                      begin)
+                .count() >= seconds)
+      exhaust(TIME);
+    if (megabytes > 0) {
+      rusage usage;
+      // ru_maxrss is in kilobytes on Linux
+      if (getrusage(RUSAGE_SELF, &usage) == 0 &&
+          usage.ru_maxrss >= megabytes * 1024)
+        exhaust(MEMORY);
+    }
+  }
+
+public:
+  bool limited() const {
+    return seconds > 0 || conflicts > 0 || decisions > 0 || megabytes > 0;
+  }
+
+  bool exhausted() const {
+    return reason.load(std::memory_order_relaxed) != NONE;
+  }
+
+  // called by a worker at every step with its counters and the part of
+  // them it has charged to the budget, which is updated. true once the
+  // budget is spent, by this worker or another
+  bool spent(const Stats &counters, Stats &charged) {
+    long long n_decisions = counters.decisions - charged.decisions;
+    long long n_conflicts = counters.conflicts - charged.conflicts;
+    if (decisions > 0 &&
+        used_decisions.load(std::memory_order_relaxed) + n_decisions >=
+            decisions)
+      exhaust(DECISIONS);
+    if (conflicts > 0 &&
+        used_conflicts.load(std::memory_order_relaxed) + n_conflicts >=
+            conflicts)
+      exhaust(CONFLICTS);
+    if (n_decisions + n_conflicts >= CHECK_INTERVAL) {
+      used_decisions.fetch_add(n_decisions, std::memory_order_relaxed);
+      used_conflicts.fetch_add(n_conflicts, std::memory_order_relaxed);
+      charged.decisions = counters.decisions;
+      charged.conflicts = counters.conflicts;
+      check_resources();
+    }
+    return exhausted();
+  }
+
+  // the limit that stopped the search, for the report
+  std::string describe() const {
+    std::ostringstream out;
+    switch (reason.load()) {
+    case TIME:
+      out << "time limit of " << seconds << " s";
+      break;
+    case CONFLICTS:
+      out << "conflict limit of " << conflicts;
+      break;
+    case DECISIONS:
+      out << "decision limit of " << decisions;
+      break;
+    case MEMORY:
+      out << "memory limit of " << megabytes << " MB";
+      break;
+    default:
+      out << "none";
+    }
+    return out.str();
+  }
+};
+
+// running totals of all the threads of a search, and a thread printing them
+// every interval. workers add what they counted since their last flush,
+// every few thousand decisions, so the shared counters stay off the hot path
+class Progress {
+private:
+  std::atomic<long long> decisions{0}, propagations{0}, conflicts{0};
+  std::mutex mtx;
+  std::condition_variable wake;
+  bool running = false;
+  std::thread printer;
+
+public:
+  // decisions between two flushes of a worker
+  static constexpr int FLUSH_INTERVAL = 4096;
+
+  void add(long long n_decisions, long long n_propagations,
+           long long n_conflicts) {
+    decisions.fetch_add(n_decisions, std::memory_order_relaxed);
+    propagations.fetch_add(n_propagations, std::memory_order_relaxed);
+    conflicts.fetch_add(n_conflicts, std::memory_order_relaxed);
+  }
+
+  // prints the totals to clog every interval until stop, over and over on
+  // one line, which is ended at the stop if anything was printed
+  void start(std::chrono::milliseconds interval = std::chrono::seconds(1)) {
+    running = true;
+    printer = std::thread([this, interval]() {
+      auto begin = std::chrono::steady_clock::now();
+      bool printed = false;
+      std::unique_lock<std::mutex> lock(mtx);
+      while (!wake.wait_for(lock, interval, [this]() { return !running; })) {
+        double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - begin)
+                             .count();
+        long long props = propagations.load(std::memory_order_relaxed);
+        std::clog << "\rDecisions: " << decisions.load() << "  Conflicts: "
+                  << conflicts.load() << "  Propagations/s: "
+                  << (long long)(props / seconds) << std::flush;
+        printed = true;
+      }
+      if (printed)
+        std::clog << std::endl;
+    });
+  }
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      if (!running)
+        return;
+      running = false;
+    }
+    wake.notify_all();
+    printer.join();
+  }
+
+  ~Progress() { stop(); }
+};
+
+#endif
@@ -1,222 +1,476 @@
-#include <bits/stdc++.h>
+#include "cdcl.h"
 
+// constraint propagation on candidate bitmasks, run before the SAT call:
+// bit num - 1 of a cell is set while num can still go there. it places the
+// naked singles (a cell with one candidate left) and the hidden singles (a
+// number with one cell left in a row, column or box) until nothing changes
+class PRESOLVER {
+public:
+  int box, n;
+  std::vector<uint64_t> candidates;    // cell -> numbers still possible
+  std::vector<int> value;              // cell -> placed number, 0 if none
+  std::vector<std::vector<int>> units; // rows, columns and boxes
+  std::vector<std::vector<int>> peers; // cell -> cells sharing a unit
+
+  explicit PRESOLVER(int box_size) : box(box_size), n(box_size * box_size) {
+    for (int row = 0; row < n; row++) {
+      units.emplace_back();
+      for (int col = 0; col < n; col++)
+        units.back().push_back(row * n + col);
+    }
+    for (int col = 0; col < n; col++) {
+      units.emplace_back();
+      for (int row = 0; row < n; row++)
+        units.back().push_back(row * n + col);
+    }
+    for (int block = 0; block < n; block++) {
+      units.emplace_back();
+      for (int i = 0; i < box; i++)
+        for (int j = 0; j < box; j++)
+          units.back().push_back((box * (block / box) + i) * n +
+                                 box * (block % box) + j);
+    }
+
+    peers.assign(n * n, {});
+    for (auto &unit : units)
+      for (int cell : unit)
+        for (int other : unit)
+          if (other != cell)
+            peers[cell].push_back(other);
+    for (auto &list : peers) {
+      std::sort(list.begin(), list.end());
+      list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+  }
+
+  // places the givens and propagates. the grid gets every forced number,
+  // and false is returned if the puzzle has no solution
+  bool run(std::vector<std::vector<int>> &grid) {
+    candidates.assign(n * n, n == 64 ? ~0ull : (1ull << n) - 1);
+    value.assign(n * n, 0);
+    for (int cell = 0; cell < n * n; cell++)
+      if (grid[cell / n][cell % n] && !place(cell, grid[cell / n][cell % n]))
+        return false;
+
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (int cell = 0; cell < n * n; cell++) {
+        if (value[cell])
+          continue;
+        if (candidates[cell] == 0)
+          return false;
+        if (__builtin_popcountll(candidates[cell]) == 1) {
+          if (!place(cell, __builtin_ctzll(candidates[cell]) + 1))
+            return false;
+          changed = true;
+        }
+      }
+      for (auto &unit : units) {
+        for (int num = 1; num <= n; num++) {
+          uint64_t bit = 1ull << (num - 1);
+          int count = 0, last = -1;
+          for (int cell : unit) {
+            if (candidates[cell] & bit) {
+              count++;
+              last = cell;
+            }
+          }
+          if (count == 0)
+            return false;
+          if (count == 1 && !value[last]) {
+            if (!place(last, num))
+              return false;
+            changed = true;
+          }
+        }
+      }
+    }
+
+    for (int cell = 0; cell < n * n; cell++)
+      grid[cell / n][cell % n] = value[cell];
+    return true;
+  }
+
+private:
+  // puts num in the cell and removes it from the candidates of its peers
+  bool place(int cell, int num) {
+    uint64_t bit = 1ull << (num - 1);
+    if (!(candidates[cell] & bit))
+      return false;
+    value[cell] = num;
+    candidates[cell] = bit;
+    for (int peer : peers[cell]) {
+      candidates[peer] &= ~bit;
+      if (candidates[peer] == 0)
+        return false;
+    }
+    return true;
+  }
+};
+
+// the sudoku rules are encoded once into an incremental solver, and the
+// givens of each puzzle are passed as assumptions. the grid is n x n with n
+// = box * box, so box 3 is the classic sudoku and 4 and 5 give the 16 x 16
+// and 25 x 25 ones
 class ENCODER {
 public:
+  int box, n;
   std::vector<std::vector<int>> sudoku;
-  std::vector<std::string> clauses;
+  PRESOLVER presolver;
+  CDCL solver;
+  // with check_unique, solve also looks for a second solution and sets
+  // multiple when there is one
+  bool check_unique = false, multiple = false;
+
+  explicit ENCODER(int box_size = 3)
+      : box(box_size), n(box_size * box_size),
+        sudoku(n, std::vector<int>(n, 0)), presolver(box_size) {}
 
-  void inputSudoku() {
+  // reads a puzzle, returns false when the input is exhausted
+  bool inputSudoku() {
     std::clog << "Enter the Sudoku puzzle (0 for empty cells):" << std::endl;
-    for (int i = 0; i < 9; i++) {
-      std::vector<int> row;
-      for (int j = 0; j < 9; j++) {
-        int num;
-        std::cin >> num;
-        row.push_back(num);
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j < n; j++) {
+        if (!(std::cin >> sudoku[i][j]))
+          return false;
       }
-      sudoku.push_back(row);
     }
+    return true;
   }
 
-  int varNum(int row, int col, int num) { return row * 100 + col * 10 + num; }
+  // symbol of a number on a one-line puzzle: 1-9, then A for 10 and so on
+  static char symbol(int num) {
+    return num < 10 ? '0' + num : 'A' + num - 10;
+  }
 
-  void addClause(const std::string &clause) { clauses.push_back(clause); }
+  // number in a cell of a one-line puzzle: '.' or 0 for an empty cell, a
+  // number, or a letter for 10 and above. -1 if the token is none of those
+  static int cellValue(const std::string &token) {
+    if (token == ".")
+      return 0;
+    if (std::all_of(token.begin(), token.end(), ::isdigit))
+      return token.size() < 4 ? std::atoi(token.c_str()) : -1;
+    if (token.size() == 1 && std::isalpha((unsigned char)token[0]))
+      return std::toupper((unsigned char)token[0]) - 'A' + 10;
+    return -1;
+  }
 
-  void cellConstraint() {
-    for (int row = 1; row <= 9; row++) {
-      for (int col = 1; col <= 9; col++) {
-        std::string clause;
-        // At least one number in cell (row, col)
-        for (int num = 1; num <= 9; num++) {
-          if (num < 9)
-            clause += std::to_string(varNum(row, col, num)) + " ";
-          else
-            clause += std::to_string(varNum(row, col, num));
-        }
-        addClause(clause);
+  // reads a puzzle written on one line, either as n * n symbols (1-9, then
+  // A for 10 and so on) or as n * n numbers separated by spaces. returns
+  // false if the line is not a puzzle
+  bool parseSudoku(const std::string &line) {
+    std::istringstream iss(line);
+    std::vector<std::string> tokens;
+    for (std::string token; iss >> token;)
+      tokens.push_back(token);
+    // a single token holds one symbol per cell
+    if (tokens.size() == 1) {
+      std::string symbols = tokens[0];
+      tokens.clear();
+      for (char ch : symbols)
+        tokens.push_back(std::string(1, ch));
+    }
+    if (tokens.size() != (size_t)(n * n))
+      return false;
 
-        // At most one number in cell (row, col)
-        for (int num1 = 1; num1 <= 9; num1++) {
-          for (int num2 = num1 + 1; num2 <= 9; num2++) {
-            addClause("~" + std::to_string(varNum(row, col, num1)) + " ~" +
-                      std::to_string(varNum(row, col, num2)));
-          }
-        }
+    for (int cell = 0; cell < n * n; cell++) {
+      int num = cellValue(tokens[cell]);
+      if (num < 0 || num > n)
+        return false;
+      sudoku[cell / n][cell % n] = num;
+    }
+    return true;
+  }
+
+  // variables are numbered densely from 0, so the solver holds exactly the
+  // n^3 cell / number pairs
+  int varNum(int row, int col, int num) {
+    return ((row - 1) * n + (col - 1)) * n + (num - 1);
+  }
+
+  Lit lit(int row, int col, int num) {
+    return make_lit(varNum(row, col, num), false);
+  }
+
+  // exactly one of the literals is true: a clause for at least one, and a
+  // native at-most-one constraint instead of a binary clause for every pair
+  void exactlyOne(const std::vector<Lit> &lits) {
+    solver.add_clause(lits);
+    solver.add_at_most(lits, 1);
+  }
+
+  void cellConstraint() {
+    for (int row = 1; row <= n; row++) {
+      for (int col = 1; col <= n; col++) {
+        std::vector<Lit> lits;
+        // Exactly one number in cell (row, col)
+        for (int num = 1; num <= n; num++)
+          lits.push_back(lit(row, col, num));
+        exactlyOne(lits);
       }
     }
   }
 
   void rowConstraint() {
-    for (int row = 1; row <= 9; row++) {
-      for (int num = 1; num <= 9; num++) {
-        std::string clause;
-        // At least one number in row
-        for (int col = 1; col <= 9; col++) {
-          if (col < 9)
-            clause += std::to_string(varNum(row, col, num)) + " ";
-          else
-            clause += std::to_string(varNum(row, col, num));
-        }
-        addClause(clause);
-
-        // At most one number in row
-        for (int col1 = 1; col1 <= 9; col1++) {
-          for (int col2 = col1 + 1; col2 <= 9; col2++) {
-            addClause("~" + std::to_string(varNum(row, col1, num)) + " ~" +
-                      std::to_string(varNum(row, col2, num)));
-          }
-        }
+    for (int row = 1; row <= n; row++) {
+      for (int num = 1; num <= n; num++) {
+        std::vector<Lit> lits;
+        // Exactly one of each number in row
+        for (int col = 1; col <= n; col++)
+          lits.push_back(lit(row, col, num));
+        exactlyOne(lits);
       }
     }
   }
 
   void colConstraint() {
-    for (int col = 1; col <= 9; col++) {
-      for (int num = 1; num <= 9; num++) {
-        std::string clause;
-        // At least one number in column
-        for (int row = 1; row <= 9; row++) {
-          if (row < 9)
-            clause += std::to_string(varNum(row, col, num)) + " ";
-          else
-            clause += std::to_string(varNum(row, col, num));
-        }
-        addClause(clause);
-
-        // At most one number in column
-        for (int row1 = 1; row1 <= 9; row1++) {
-          for (int row2 = row1 + 1; row2 <= 9; row2++) {
-            addClause("~" + std::to_string(varNum(row1, col, num)) + " ~" +
-                      std::to_string(varNum(row2, col, num)));
-          }
-        }
+    for (int col = 1; col <= n; col++) {
+      for (int num = 1; num <= n; num++) {
+        std::vector<Lit> lits;
+        // Exactly one of each number in column
+        for (int row = 1; row <= n; row++)
+          lits.push_back(lit(row, col, num));
+        exactlyOne(lits);
       }
     }
   }
 
   void gridConstraint() {
-    for (int block = 0; block < 9; block++) {
-      for (int num = 1; num <= 9; num++) {
-        std::string clause;
-        // At least one number in block
-        for (int i = 1; i <= 3; i++) {
-          for (int j = 1; j <= 3; j++) {
-            int row = 3 * (block / 3) + i;
-            int col = 3 * (block % 3) + j;
-            if (i == 3 && j == 3)
-              clause += std::to_string(varNum(row, col, num));
-            else
-              clause += std::to_string(varNum(row, col, num)) + " ";
-          }
-        }
-        addClause(clause);
-        // At most one number in block
-        for (int i1 = 1; i1 <= 3; i1++) {
-          for (int j1 = 1; j1 <= 3; j1++) {
-            for (int i2 = 1; i2 <= 3; i2++) {
-              for (int j2 = 1; j2 <= 3; j2++) {
-                if (i1 * 3 + j1 < i2 * 3 + j2) {
-                  addClause("~" +
-                            std::to_string(varNum(3 * (block / 3) + i1,
-                                                  3 * (block % 3) + j1, num)) +
-                            " ~" +
-                            std::to_string(varNum(3 * (block / 3) + i2,
-                                                  3 * (block % 3) + j2, num)));
-                }
-              }
-            }
+    for (int block = 0; block < n; block++) {
+      for (int num = 1; num <= n; num++) {
+        std::vector<Lit> lits;
+        // Exactly one of each number in block
+        for (int i = 1; i <= box; i++) {
+          for (int j = 1; j <= box; j++) {
+            int row = box * (block / box) + i;
+            int col = box * (block % box) + j;
+            lits.push_back(lit(row, col, num));
           }
         }
+        exactlyOne(lits);
       }
     }
   }
 
-  void knownConstraint() {
-    for (int row = 1; row <= 9; row++) {
-      for (int col = 1; col <= 9; col++) {
+  // the givens of the puzzle, and the numbers the presolver placed, passed
+  // to the solver as assumptions
+  std::vector<Lit> knownConstraint() {
+    std::vector<Lit> assumptions;
+    for (int row = 1; row <= n; row++) {
+      for (int col = 1; col <= n; col++) {
         if (sudoku[row - 1][col - 1] != 0) {
-          addClause(std::to_string(varNum(row, col, sudoku[row - 1][col - 1])));
+          assumptions.push_back(lit(row, col, sudoku[row - 1][col - 1]));
         }
       }
     }
+    return assumptions;
   }
 
+  // encodes the rules, once for all the puzzles
   void encode() {
     cellConstraint();
     rowConstraint();
     colConstraint();
     gridConstraint();
-    knownConstraint();
   }
 
-  void saveCNF(const std::string &filename) {
-    std::ofstream file(filename);
-    for (const auto &clause : clauses) {
-      file << clause << std::endl;
-    }
-    file.close();
-  }
+  // solves the current puzzle in place, returns false if it has no solution.
+  // the presolver fills the forced cells first, and the SAT solver is only
+  // called if some are left. to check uniqueness, the solver enumerates up
+  // to two solutions in the same call; a grid the presolver completes is
+  // unique, since it only places forced numbers
+  bool solve() {
+    multiple = false;
+    if (!presolver.run(sudoku))
+      return false;
+    bool complete = true;
+    for (auto &row : sudoku)
+      complete &= std::count(row.begin(), row.end(), 0) == 0;
+    if (complete)
+      return true;
 
-  void loadSOL(const std::string &filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-      std::cerr << "Error opening file " << filename << std::endl;
-      return;
+    auto fill = [this](const std::vector<signed char> &model) {
+      for (int row = 1; row <= n; row++)
+        for (int col = 1; col <= n; col++)
+          for (int num = 1; num <= n; num++)
+            if (model[varNum(row, col, num)] > 0)
+              sudoku[row - 1][col - 1] = num;
+    };
+    if (!check_unique) {
+      if (solver.solve(knownConstraint()) != SATISFIABLE)
+        return false;
+      fill(solver.model);
+      return true;
     }
 
-    std::string line;
-    while (std::getline(file, line)) {
-      if (line.find("Debug:") != std::string::npos) {
-        continue;
-      }
+    bool first = true;
+    long long found = solver.enumerate(
+        knownConstraint(), 2, {},
+        [&](const std::vector<signed char> &model) {
+          if (first)
+            fill(model);
+          first = false;
+        });
+    multiple = found > 1;
+    return found > 0;
+  }
 
-      if (line[0] != '~') {
-        int row = (line[0] - '0');
-        int col = (line[1] - '0');
-        int num = (line[2] - '0');
-        sudoku[row - 1][col - 1] = num;
+  // the grid on one line, in the batch output format: symbols up to 35 x 35
+  // and numbers separated by spaces beyond
+  std::string toLine() const {
+    std::string line;
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j < n; j++) {
+        if (n <= 35) {
+          line += symbol(sudoku[i][j]);
+        } else {
+          if (!line.empty())
+            line += ' ';
+          line += std::to_string(sudoku[i][j]);
+        }
       }
     }
-    file.close();
+    return line;
   }
 
   void printSudoku() {
+    int width = std::to_string(n).size();
     std::cout << "Sudoku solution:" << std::endl;
-    for (int i = 0; i < 9; i++) {
-      for (int j = 0; j < 9; j++) {
-        std::cout << sudoku[i][j] << " ";
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j < n; j++) {
+        std::cout << std::setw(width) << sudoku[i][j] << " ";
       }
       std::cout << std::endl;
     }
   }
 };
 
-int main() {
-  ENCODER encoder;
-  encoder.inputSudoku();
-  encoder.encode();
-  encoder.saveCNF("sudoku.cnf");
+// solves every puzzle of the input file, one per line, on a pool of threads.
+// each thread owns an encoder, so the rules are encoded once per thread and
+// nothing is shared while solving. the solutions are written in the input
+// order as soon as all the puzzles before them are solved; a line that is
+// not a puzzle or has no solution gives "No solution", and with unique
+// one with several solutions gives "Multiple solutions"
+int batch(const std::string &input_file, const std::string &output_file,
+          int box, int n_threads, bool unique) {
+  std::ifstream input(input_file);
+  if (!input) {
+    std::cerr << "Error opening file " << input_file << std::endl;
+    return 1;
+  }
+  std::vector<std::string> puzzles;
+  std::string line;
+  while (std::getline(input, line))
+    if (line.find_first_not_of(" \t\r") != std::string::npos)
+      puzzles.push_back(line);
+
+  std::ofstream output(output_file);
+  if (!output) {
+    std::cerr << "Error opening file " << output_file << std::endl;
+    return 1;
+  }
+
+  std::vector<std::string> results(puzzles.size());
+  std::vector<char> done(puzzles.size(), 0);
+  std::mutex mutex;
+  std::condition_variable solved;
+  std::atomic<size_t> next{0};
 
-  std::cout << "\nSolving Sudoku using DPLL solver..." << std::endl;
+  auto worker = [&]() {
+    ENCODER encoder(box);
+    encoder.encode();
+    encoder.check_unique = unique;
+    for (size_t i; (i = next.fetch_add(1)) < puzzles.size();) {
+      std::string result = "No solution";
+      if (encoder.parseSudoku(puzzles[i]) && encoder.solve())
+        result = encoder.multiple ? "Multiple solutions" : encoder.toLine();
+      std::lock_guard<std::mutex> lock(mutex);
+      results[i] = std::move(result);
+      done[i] = 1;
+      solved.notify_one();
+    }
+  };
+
+  auto begin = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < n_threads; t++)
+    threads.emplace_back(worker);
 
-  int result = system("./dpll sudoku.cnf");
-  if (result != 0) {
-    std::cerr << "Error executing DPLL solver." << std::endl;
-    return 1; // Exit with error code
+  for (size_t i = 0; i < puzzles.size(); i++) {
+    std::unique_lock<std::mutex> lock(mutex);
+    solved.wait(lock, [&]() { return done[i]; });
+    std::string result = std::move(results[i]);
+    lock.unlock();
+    output << result << '\n';
   }
+  for (auto &thread : threads)
+    thread.join();
+  output.close();
 
-  encoder.loadSOL("output_dpll.txt");
-  encoder.printSudoku();
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - begin)
+                       .count();
+  std::cout << "Solved " << puzzles.size() << " puzzles in " << seconds
+            << "s with " << n_threads << " threads ("
+            << (seconds > 0 ? puzzles.size() / seconds : 0.0)
+            << " puzzles/s), solutions written to " << output_file
+            << std::endl;
+  return 0;
+}
 
-  if (remove("sudoku.cnf") != 0) {
-    std::cerr << "Error deleting sudoku.cnf" << std::endl;
-  } else {
-    std::cout << "\nsudoku.cnf is deleted successfully";
+int main(int argc, char *argv[]) {
+  // usage: ./sudoku [--box B]          read puzzles as numbers from stdin
+  //        ./sudoku [--box B] --batch <in> <out> [--threads N]
+  // the grids are B^2 x B^2, 9 x 9 by default. with --unique, the solver
+  // also checks that each puzzle has a single solution
+  std::string input_file, output_file;
+  int box = 3;
+  bool unique = false;
+  int n_threads = std::max(1u, std::thread::hardware_concurrency());
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--batch" && i + 2 < argc) {
+      input_file = argv[++i];
+      output_file = argv[++i];
+    } else if (arg == "--threads" && i + 1 < argc) {
+      n_threads = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--box" && i + 1 < argc) {
+      box = std::atoi(argv[++i]);
+    } else if (arg == "--unique") {
+      unique = true;
+    } else {
+      box = 0;
+      break;
+    }
   }
-  if (remove("output_dpll.txt") != 0) {
-    std::cerr << "Error deleting output_dpll.txt" << std::endl;
-  } else {
-    std::cout << "\noutput_dpll.txt is deleted successfully";
+  // the presolver keeps the candidates of a cell in 64 bits
+  if (box < 1 || box > 8) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--box B] [--unique] [--batch <input_file> <output_file> "
+                 "[--threads N]]"
+              << std::endl;
+    return 1;
+  }
+  if (!input_file.empty())
+    return batch(input_file, output_file, box, n_threads, unique);
+
+  ENCODER encoder(box);
+  encoder.encode();
+  encoder.check_unique = unique;
+
+  // puzzles are read until the end of the input, all of them reuse the
+  // encoded rules and what the solver learned on the previous ones
+  while (encoder.inputSudoku()) {
+    std::cout << "\nSolving Sudoku using CDCL solver..." << std::endl;
+    if (encoder.solve()) {
+      encoder.printSudoku();
+      if (unique)
+        std::cout << (encoder.multiple ? "The puzzle has several solutions"
+                                       : "The solution is unique")
+                  << std::endl;
+    } else
+      std::cout << "No solution" << std::endl;
   }
 
   return 0;